@@ -3,13 +3,55 @@
  */
 
 #include "adc.h"
+#include "ttc.h"		/* sampling timer */
+#include "rec.h"		/* field recorder */
 
 /* Experimentally observed is 63000, but we will round to 2 decimal places, so we have .01 tolerance*/
-#define MAXADC 62700.0f
+#define MAXADC 62700U
+#define HYST 	(MAXADC / 200)		/* half a percent either way before the percent moves */
 
 /* ADC device onboard the ps */
 static XAdcPs XADCPortPs;
 
+// pot acquisition, all updated from the sampling timer's interrupt
+static u32 sum = 0;					/* raw samples since the last decimation */
+static u32 count = 0;
+static u32 filt = 0;				/* iir state, raw << ADC_IIR_SHIFT */
+static bool seeded = false;			/* filt holds something since adc_pot_start */
+static volatile u32 potRaw = 0;		/* filtered raw value */
+static volatile u32 potPercent = 0;	/* potRaw as a percent, with hysteresis */
+
+/*
+ * one pot sample; every ADC_OVERSAMPLE of them are averaged into the iir
+ */
+static void pot_sample(u32 timer) {
+	u16 raw = XAdcPs_GetAdcData(&XADCPortPs, XADCPS_AUX14_OFFSET);
+	u32 avg, lo, hi, pct;
+
+	(void)timer;
+	rec_adc(raw);
+	sum += raw;
+	if (++count < ADC_OVERSAMPLE) return;
+
+	avg = sum / ADC_OVERSAMPLE;
+	sum = 0;
+	count = 0;
+
+	// first average seeds the filter, so a restart doesn't creep up from 0
+	if (!seeded) filt = avg << ADC_IIR_SHIFT;
+	else filt += avg - (filt >> ADC_IIR_SHIFT);
+	seeded = true;
+	potRaw = filt >> ADC_IIR_SHIFT;
+
+	// only move the percent once the value is clear of the boundary
+	lo = (potRaw > HYST) ? (potRaw - HYST) * 100 / MAXADC : 0;
+	hi = (potRaw + HYST) * 100 / MAXADC;
+	pct = potPercent;
+	if (pct < lo) pct = lo;
+	if (pct > hi) pct = hi;
+	potPercent = (pct > 100) ? 100 : pct;
+}
+
 /*
  * initialize the adc module
  */
@@ -20,6 +62,28 @@ void adc_init(void){
 	XAdcPs_SetAlarmEnables(&XADCPortPs, 0U);
 	XAdcPs_SetSeqChEnables(&XADCPortPs, XADCPS_SEQ_CH_TEMP | XADCPS_SEQ_CH_VCCINT | XADCPS_SEQ_CH_AUX14);
 	XAdcPs_SetSequencerMode(&XADCPortPs, XADCPS_SEQ_MODE_CONTINPASS);
+
+	ttc_timer_callback(TIMER_ADC, &pot_sample);
+}
+
+void adc_pot_start(void) {
+	u32 raw = XAdcPs_GetAdcData(&XADCPortPs, XADCPS_AUX14_OFFSET);
+
+	rec_adc((u16)raw);
+	ttc_timer_stop(TIMER_ADC);
+	sum = 0;
+	count = 0;
+	seeded = false;
+
+	// good enough until the first average is in
+	potRaw = raw;
+	potPercent = (raw * 100 / MAXADC > 100) ? 100 : raw * 100 / MAXADC;
+
+	ttc_timer_start(TIMER_ADC, 1000 / ADC_SAMPLE_HZ, true);
+}
+
+void adc_pot_stop(void) {
+	ttc_timer_stop(TIMER_ADC);
 }
 
 /*
@@ -45,10 +109,9 @@ float adc_get_vccint(void){
  */
 float adc_get_pot(void){
 	// reading external signals uses a 1.0V reference (can't use built-in func)
-	u16 rawData = XAdcPs_GetAdcData(&XADCPortPs, XADCPS_AUX14_OFFSET);
-	return ((float)(rawData))/MAXADC;
+	return ((float)potRaw)/MAXADC;
 }
 
 u32 adc_get_pot_percent(void) {
-	return (u32)(adc_get_pot()*100);
+	return potPercent;
 }
@@ -1,5 +1,12 @@
 /*
  * adc.h -- The ADC module interface
+ *
+ * The pot is sampled on a ttc timer at ADC_SAMPLE_HZ while acquisition is
+ * started; every ADC_OVERSAMPLE samples are averaged and fed to a first
+ * order iir (alpha 2^-ADC_IIR_SHIFT), all in integers in the timer
+ * interrupt, so the getters just return what the last sample left.
+ * (The PS XADC interface has no end of sequence interrupt, the sequencer
+ * converts continuously and each sample reads its latest result.)
  */
 #pragma once
 
@@ -8,11 +15,27 @@
 #include "xparameters.h"  	/* constants used by the hardware */
 #include "xil_types.h"		/* types used by xilinx */
 
+#ifndef ADC_SAMPLE_HZ
+#define ADC_SAMPLE_HZ 	200		/* pot samples per second, at most 1000 */
+#endif
+#define ADC_OVERSAMPLE 	8		/* samples averaged per filter step */
+#define ADC_IIR_SHIFT 	3		/* filter alpha = 1/8 per step, ~0.3s to settle */
+
 /*
  * initialize the adc module
  */
 void adc_init(void);
 
+/*
+ * start sampling the pot, seeding the filter afresh
+ */
+void adc_pot_start(void);
+
+/*
+ * stop sampling the pot; the getters keep the last filtered value
+ */
+void adc_pot_stop(void);
+
 /*
  * get the internal temperature in degree's centigrade
  */
@@ -24,11 +47,12 @@ float adc_get_temp(void);
 float adc_get_vccint(void);
 
 /*
- * get the **corrected** potentiometer voltage (should be between 0 and 1v)
+ * get the **corrected**, filtered potentiometer voltage (should be between 0 and 1v)
  */
 float adc_get_pot(void);
 
 /*
- * get the potentiometer percentage of max voltage(0% to 100%)
+ * get the filtered potentiometer percentage of max voltage (0% to 100%),
+ * which only moves once the value is half a percent past a boundary
  */
 u32 adc_get_pot_percent(void);
@@ -1,324 +1,312 @@
 /*
  * fsm.c -- Event-Driven Finite State Machine for Traffic Control System
  *
+ * All of an intersection's state is in its fsm_t and all it drives goes
+ * through the fsm's ops (c.f. fsm.h), so a process can run any number of
+ * them; fsm_board.c binds the board's to the drivers.
  */
 
 #include "fsm.h"
-
-#define UPDATE_BYTE_COUNT sizeof(update_response_t)
-
-#define FETCH_FREQ 3						/* how often to poll server for train status, per 100ms */
+#include "fsm_table.h"		/* generated from fsm_spec.h */
+#include "trace.h"			/* deferred logging */
+#include "xil_exception.h"	/* masking interrupts */
+#include "xpseudo_asm.h"	/* cpsr access */
 
 /************************ STATIC FUNCTION DECLARATIONS ***********************/
 
-static void set_blue(bool on_off);
-static void reset_ttc(void);
-static void restart_ttc(int trig);
-static void change_state(int transition);
-static void generate_outputs(void);
-
-/****************************** STATIC VARIABLES *****************************/
-
-static bool ttcIsOn = false;		/* if we are using ttc for FSM (rather than just polling uart0) */
-static int counter = 0;             /* counter/divider for ttc, which operates at 10 Hz */
-static int trigger;				    /* desired trigger (sec) to run new code */
-static int state;					/* current FSM state */
-static bool blueStatus = LED_OFF;   /* LED6 Blue-light status (On/Off) */
-
-// uart0 interfacing
-static int fetchCounter = 0; 		/* fetch every 300ms > 250ms */
-static update_request_t request = {UPDATE, SERVER_ID, SERVER_START_VAL};
-static update_response_t response;
-static u8 responseCount = 0;
-static int remoteTrans;
-
-static bool init = true;
+static void set_blue(fsm_t *fsm, bool on_off);
+static void reset_ttc(fsm_t *fsm);
+static void restart_ttc(fsm_t *fsm, int trig);
+static void change_state(fsm_t *fsm, int transition);
+static void generate_outputs(fsm_t *fsm);
+static void gate_check(fsm_t *fsm);
+
+/****************************** OUTPUT TABLE *****************************/
+
+#define GATE_KEEP	0
+#define GATE_OPEN	1
+#define GATE_CLOSE	2
+
+typedef struct {
+	int trigger;			/* state timeout (sec) started on entry, 0 for none */
+	int gate;				/* GATE_KEEP, GATE_OPEN or GATE_CLOSE */
+	int note;				/* trace event logged once the gate is where the state put it, -1 for none */
+	bool ped;				/* PED light */
+	u32 light;				/* traffic light, OFF for none */
+	bool blue;				/* BLUE light, toggled by the ttc while in the state */
+	int then;				/* transition taken right after entry, -1 for none */
+} output_t;
+
+// what each state drives on entry, as one output vector (c.f. traffic_wrapper.h)
+static const output_t outputs[FSM_NUM_STATES] = {
+	/************************** GENERAL STATES *****************************/
+	[PEDESTRIAN]	= { PED_TIME,	GATE_OPEN,	-1, LED_ON,  R,   false, -1 },
+	[Y2G]			= { LIGHT_TIME,	GATE_OPEN,	-1, LED_OFF, Y,   false, -1 },
+	[Y2R]			= { LIGHT_TIME,	GATE_OPEN,	-1, LED_OFF, Y,   false, -1 },
+	[V_MIN]			= { V_MIN_TIME,	GATE_OPEN,	-1, LED_OFF, G,   false, -1 },
+	[V_OK]			= { 0,			GATE_OPEN,	-1, LED_OFF, G,   false, -1 },
+	[V_MIN_PED]		= { 0,			GATE_OPEN,	-1, LED_OFF, G,   false, -1 },
+
+	/***************************** TRAIN STATES *********************************/
+	[Y_TRAIN]		= { LIGHT_TIME,	GATE_OPEN,	-1, LED_OFF, Y,   false, -1 },
+	[TRAIN]			= { 0,			GATE_CLOSE,	TR_GATE_CLOSED, LED_ON, R, false, -1 },
+	[PED_TRAIN]		= { PED_TIME,	GATE_OPEN,	TR_GATE_OPEN,   LED_ON, R, false, -1 },
+
+	/************************** MAINTENANCE STATES *********************************/
+	[MAINTENANCE]	= { BLUE_TIME,	GATE_KEEP,	-1, LED_OFF, OFF, true,  -1 },
+	[M_TRAIN]		= { BLUE_TIME,	GATE_KEEP,	-1, LED_OFF, OFF, true,  -1 },
+	[M_CLR]			= { 0,			GATE_KEEP,	-1, LED_OFF, OFF, false, DEFAULT },
+};
 
 /**/
 
-static void set_blue(bool on_off) {
-	blueStatus = on_off;
-	set_blue_light(blueStatus);
+static void set_blue(fsm_t *fsm, bool on_off) {
+	fsm->blueStatus = on_off;
+	fsm->outv.light = (fsm->blueStatus) ? B : OFF;
 }
 
-static void restart_ttc(int trig) {
-	trigger = trig;
-	ttcIsOn = true;
-
-	ttc_stop();
-	ttc_reset();
-	ttc_start();
+/*
+ * start the timers a state runs: a blue blink every trig seconds & pot
+ * sampling in maintenance, else a trig second timeout
+ */
+static void restart_ttc(fsm_t *fsm, int trig) {
+	const fsm_ops_t *ops = fsm->ops;
+
+	if (M_STATES(fsm->state)) {
+		ops->timer_stop(fsm, TIMER_STATE);
+		ops->timer_start(fsm, TIMER_BLUE, trig * 1000, true);
+		ops->timer_start(fsm, TIMER_POT, POT_MS, true);
+		ops->pot(fsm, true);
+	}
+	else {
+		ops->timer_stop(fsm, TIMER_BLUE);
+		ops->timer_stop(fsm, TIMER_POT);
+		ops->pot(fsm, false);
+		ops->timer_start(fsm, TIMER_STATE, trig * 1000, false);
+	}
 }
 
-static void reset_ttc(void) {
-	counter = 0;
-	ttcIsOn = false;
+static void reset_ttc(fsm_t *fsm) {
+	const fsm_ops_t *ops = fsm->ops;
+
+	ops->timer_stop(fsm, TIMER_STATE);
+	ops->timer_stop(fsm, TIMER_BLUE);
+	ops->timer_stop(fsm, TIMER_POT);
+	ops->pot(fsm, false);
 }
 
-/****************************** PERIPHERAL CALLBACKS *******************************/
+/****************************** EVENTS & SERVER *******************************/
 
-void ttc_callback(void) {
-	// poll Wifi Module # 300ms intervals (counter increments @ 100ms intervals)
-	fetchCounter++;
-	if (fetchCounter >= FETCH_FREQ) {
-		uart_send(WIFI_DEV, (void*) &request, sizeof(update_request_t));
-		fetchCounter = 0;
-	}
+void fsm_init(fsm_t *fsm, const fsm_ops_t *ops, int id) {
+	*fsm = (fsm_t)FSM_INITIALIZER(ops, id);
+}
 
-	// FSM
-	if (ttcIsOn) {
-		counter++;
+/*
+ * queue an event for fsm_step; the callbacks only ever post, so the FSM never
+ * runs in interrupt context. On the board the posters are the ISRs and the
+ * main loop (fsm_server, from uart_poll); interrupts are masked while we
+ * claim the slot, so there is one producer at a time whoever calls, and the
+ * main loop is the only consumer.
+ */
+void fsm_post(fsm_t *fsm, int event) {
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	u32 head = fsm->evHead;
+	if (head - __atomic_load_n(&fsm->evTail, __ATOMIC_ACQUIRE) >= FSM_QUEUE_SIZE) fsm->evDropped++;
+	else {
+		fsm->events[head & (FSM_QUEUE_SIZE - 1)] = (s8)event;
+		__atomic_store_n(&fsm->evHead, head + 1, __ATOMIC_RELEASE);
+	}
 
-		// polling potentiometer if in MAINTENANCE STATES
-		if (M_STATES) {
-			manual_gate();
-		}
+	mtcpsr(cpsr);
+}
 
-		if (counter >= trigger*10) {
-			if (M_STATES) {
-				//restart the counter
-				counter = 0;
+void fsm_server(fsm_t *fsm, const server_msg_t *msg) {
+	int newTrans;
+	int newVersion = fsm->remoteVersion;
+
+	// analyze value @ our id for potential transition
+	switch (msg->type) {
+		case UPDATE:
+			// unversioned, so only good for a first value; a late one mustn't overwrite a versioned value
+			if (!fsm->init) return;
+			// an UPDATE reply only holds the ids that fit in values[]; crossings beyond that learn their value from SUBSCRIBE/NOTIFY
+			if (fsm->id < 0 || fsm->id >= (int)(sizeof(msg->update.values) / sizeof(msg->update.values[0]))) return;
+			newTrans = msg->update.values[fsm->id];
+			break;
+		case FETCH:
+		case SUBSCRIBE:
+			newTrans = msg->fetch.value;
+			newVersion = msg->fetch.version;
+			break;
+		case NOTIFY:
+			if (msg->notify.id != fsm->id) return;
+			newTrans = msg->notify.value;
+			newVersion = msg->notify.version;
+			break;
+		default:
+			return;
+	}
 
-				// toggle blue
-				set_blue(!blueStatus);
-			}
-			else {
-				// reset and stop counter before changing state
-				reset_ttc();
-				// change state
-				change_state(T_INT);
-			}
+	// deal with server response
+	if (fsm->init) {
+		fsm->remoteTrans = newTrans;
+		fsm->remoteVersion = newVersion;
+		fsm->init = false;
+	}
+	else {
+		// an unchanged version means nobody wrote our id since the last message
+		if (newVersion != fsm->remoteVersion && newTrans >= M_SW_HI && newTrans <= T_SW_LO && newTrans != fsm->remoteTrans) {
+			fsm->remoteTrans = newTrans;
+			fsm_post(fsm, newTrans);
 		}
+		else fsm->remoteTrans = newTrans;
+		fsm->remoteVersion = newVersion;
 	}
 }
 
-void btn_callback(u32 btn) {
-	if (btn == 3)
-		change_state(DONE);
-	else if (btn == 0 || btn == 1)
-		change_state(P_BTN);
+static void subscribe(fsm_t *fsm) {
+	subscribe_request_t request = {SUBSCRIBE | FRAMED, fsm->id};
+
+	fsm->ops->send(fsm, (void*) &request, sizeof(subscribe_request_t));
 }
 
-void sw_callback(u32 sw) {
-	bool hi = ( (1 << sw) & io_sw_read() ) > 0; // checks whether bit position @ sw is set to hi/lo
+/************************************** FSM LOGIC ********************************/
 
-	if (sw == 0 && hi) 	  	 change_state(M_SW_HI);
-	else if (sw == 0 && !hi) change_state(M_SW_LO);
-	else if (sw == 1 && hi)  change_state(T_SW_HI);
-	else if (sw == 1 && !hi) change_state(T_SW_LO);
-}
+void fsm_connect(fsm_t *fsm) {
+	update_request_t request = {UPDATE | FRAMED, fsm->id, SERVER_START_VAL};
 
-void update_response_callback(u8 buffer) {
-	// receive each byte and store it at the next available byte
-	u8* updateRecv = (u8*) &response + responseCount;
-	*updateRecv = buffer;
-	responseCount++;
+	// synchronize w/ server value, setting to default -1, then have changes pushed to us
+	fsm->ops->send(fsm, (void*) &request, sizeof(update_request_t));
+	subscribe(fsm);
+	fsm->ops->timer_start(fsm, TIMER_WIFI, SUBSCRIBE_MS, true);	// renewal also repairs a lost NOTIFY
+}
 
-	// if response is fully stored, analyze value @ SERVER_ID for potential transition
-	if (responseCount == UPDATE_BYTE_COUNT) {
-		int newTrans = response.values[SERVER_ID];
+void fsm_start(fsm_t *fsm) {
+	fsm->state = PEDESTRIAN;
+	generate_outputs(fsm);
+	fsm->ops->commit(fsm, &fsm->outv);
+}
 
-		// deal with server response
-		if (init) {
-			remoteTrans = newTrans;
-			init = false;
-		}
-		else {
-			if (newTrans >= M_SW_HI && newTrans <= T_SW_LO && newTrans != remoteTrans) {
-				remoteTrans = newTrans;
-				change_state(newTrans);
-			}
-			else remoteTrans = newTrans;
-		}
+/*
+ * a timer expired, run by fsm_step; an expiry queued before its timer was
+ * restarted or stopped is stale and take() says so
+ */
+static void timer_expired(fsm_t *fsm, u32 timer) {
+	if (!fsm->ops->timer_take(fsm, timer)) return;
 
-		// reset update
-		responseCount = 0;
+	switch (timer) {
+		case TIMER_STATE:
+			change_state(fsm, T_INT);
+			break;
+		case TIMER_BLUE:
+			set_blue(fsm, !fsm->blueStatus);
+			fsm->ops->commit(fsm, &fsm->outv);
+			break;
+		case TIMER_POT:
+			fsm->outv.gate = fsm->ops->manual_gate(fsm);
+			fsm->ops->commit(fsm, &fsm->outv);
+			break;
+		case TIMER_WIFI:
+			subscribe(fsm);
+			break;
+		default:
+			break;
 	}
 }
 
-/************************************** FSM LOGIC ********************************/
+void fsm_step(fsm_t *fsm) {
+	u32 tail = fsm->evTail;
 
-void init_state(void) {
-	// synchronize w/ server value, setting to default -1
-	uart_send(WIFI_DEV, (void*) &request, sizeof(update_request_t));
-	request.id = REQUEST_ID; // setup our future requests to update id 0 and value 0
-	request.value = DUMMY;
+	while (fsm->state != DONE && tail != __atomic_load_n(&fsm->evHead, __ATOMIC_ACQUIRE)) {
+		int event = fsm->events[tail & (FSM_QUEUE_SIZE - 1)];
+		__atomic_store_n(&fsm->evTail, ++tail, __ATOMIC_RELEASE);
 
-	printf("Starting in Pedestrian state!\n");
-	sleep(1);
-	state = PEDESTRIAN;
-	generate_outputs();
+		if (event >= TIMER_EVENT) timer_expired(fsm, event - TIMER_EVENT);
+		else if (event == GATE_EVENT) gate_check(fsm);
+		else change_state(fsm, event);
+	}
 }
 
-int get_state(void) {
-	return state;
+bool fsm_queued(const fsm_t *fsm) {
+	return __atomic_load_n(&fsm->evHead, __ATOMIC_ACQUIRE) != fsm->evTail;
 }
 
-static void change_state(int transition) {
-	// path to exit program
-	if (transition == DONE) {
-		state = DONE;
-		return;
-	}
-
-	// printing Maintenance entry/exit and train arriving/clearing
+/*
+ * what a transition does on its way, whatever the next state (c.f. FSM_ACTIONS in fsm_spec.h)
+ */
+static void transition_action(fsm_t *fsm, int transition, bool act) {
 	switch (transition) {
 		case M_SW_HI:
-			if (!M_STATES) { // error-checking
-				printf("Maintenance entry!\n");
-			}
+			if (act) trace(TR_M_ENTRY, 0, 0, 0);
 			break;
 		case M_SW_LO:
-			if (M_STATES) { // error-checking
-				printf("Maintenance exit!\n");
-				reset_ttc(); 				// clear the blue light maintenance counter as we leave MAINTENANCE
-				set_blue(LED_OFF);
+			if (act) {
+				trace(TR_M_EXIT, 0, 0, 0);
+				reset_ttc(fsm); 			// clear the blue light maintenance counter as we leave MAINTENANCE
+				set_blue(fsm, LED_OFF);
 			}
 			break;
 		case T_SW_HI:
-			printf("Train is arriving!\n");
-			if (!M_STATES && state != Y_TRAIN) {
-				reset_ttc(); 	 				// clear the timer counter
-			}
+			trace(TR_T_ARRIVING, 0, 0, 0);
+			if (act) reset_ttc(fsm); 		// clear the timer counter
 			break;
 		case T_SW_LO:
-			if (T_STATES) { // error-checking
-				printf("Train is clearing!\n");
-			}
+			if (act) trace(TR_T_CLEARING, 0, 0, 0);
 			break;
 		default:
 			break;
 	}
+}
 
-	// next state logic
-	int next_state = state;
-	switch (state) {
-		/**************************** GENERAL STATES ***************************/
-		case PEDESTRIAN:
-			if (transition == T_INT) 		next_state = Y2G;
-			break;
-		case Y2G:
-			if (transition == T_INT)		next_state = V_MIN;
-			break;
-		case Y2R:
-			if (transition == T_INT) 		next_state = PEDESTRIAN;
-			break;
-		case V_MIN:
-			if (transition == T_INT) 		next_state = V_OK;
-			else if (transition == P_BTN) 	next_state = V_MIN_PED;
-			break;
-		case V_OK:
-			if (transition == P_BTN) 		next_state = Y2R;
-			break;
-		case V_MIN_PED:
-			if (transition == T_INT) 		next_state = Y2R;
-			break;
-
-		/**************************** TRAIN STATES ***************************/
-		case TRAIN:
-			if (transition == M_SW_HI) 		next_state = M_TRAIN;
-			else if (transition == T_SW_LO) next_state = PED_TRAIN;
-			break;
-		case Y_TRAIN:
-			if (transition == M_SW_HI) 		next_state = M_TRAIN;
-			else if (transition == T_INT) 	next_state = TRAIN;
-			else if (transition == T_SW_LO) next_state = PED_TRAIN;
-			break;
-		case PED_TRAIN:
-			if (transition == T_SW_HI) 		next_state = TRAIN;
-			else if (transition == T_INT) 	next_state = Y2G;
-			break;
+static void change_state(fsm_t *fsm, int transition) {
+	int state = fsm->state;
 
-		/*********************** MAINTENANCE STATES ************************/
-		case MAINTENANCE:
-			if (transition == T_SW_HI) 		next_state = M_TRAIN;
-			else if (transition == M_SW_LO) next_state = PEDESTRIAN;
-			break;
-		case M_TRAIN:
-			if (transition == T_SW_LO) 		next_state = M_CLR;
-			else if (transition == M_SW_LO) next_state = TRAIN;
-			break;
-		case M_CLR:
-			if (transition == T_SW_HI) 		next_state = M_TRAIN;
-			else 							next_state = MAINTENANCE;
-			break;
-		default:
-			break;
+	// path to exit program
+	if (transition == DONE) {
+		fsm->state = DONE;
+		return;
 	}
+	if (state < 0 || state >= FSM_NUM_STATES || transition < 0 || transition >= FSM_NUM_TRANS)
+		return;
 
-	// train arriving 2nd highest precedence (ignoring if in MAINTENANCE STATE or PED_TRAIN/TRAIN)
-	if (transition == T_SW_HI && !M_STATES && state != PED_TRAIN && state != TRAIN)
-		next_state = Y_TRAIN;
+	// next state & whether the transition's action runs, precedence already resolved (c.f. fsm_spec.h)
+	u8 entry = fsmTable[state][transition];
+	int next_state = entry & FSM_NEXT_MASK;
 
-	// maintenance highest precedence (ignoring if in TRAIN or MAINTENANCE state)
-	if (transition == M_SW_HI && !T_STATES && !M_STATES)
-		next_state = MAINTENANCE;
+	transition_action(fsm, transition, entry & FSM_ACT);
 
 	/***************************** GENERATE OUTPUTS FOR NEXT STATE *****************************/
-	printf("curr state: %d, next state: %d, transition: %d\n", state, next_state, transition);
+	trace(TR_STATE, state, next_state, transition);
 	if (next_state != state) {
-		state = next_state;
-		generate_outputs();
+		fsm->state = next_state;
+		generate_outputs(fsm);
 	}
+	fsm->ops->commit(fsm, &fsm->outv);		// one write per port that changed, whatever the path here
+	gate_check(fsm);
 }
 
-static void generate_outputs(void) {
-	// default outputs (PED light off, Traffic lights off)
-	set_ped_light(LED_OFF);
-	close_traffic_light();
-
-	switch (state) {
-		/************************** GENERAL STATES *****************************/
-		case PEDESTRIAN: 				// open gate, set PED light, set RED light, load PED_TIME timer trigger
-			restart_ttc(PED_TIME);
-			open_gate();
-			set_ped_light(LED_ON);
-			set_traffic_light(R);
-			break;
-		case Y2G: 						// same outputs as Y2R
-		case Y2R:						// open gate, set YELLOW light, load LIGHT_TIME timer trigger
-			restart_ttc(LIGHT_TIME);
-			open_gate();
-			set_traffic_light(Y);
-			break;
-		case V_MIN:						// load V_MIN_TIME timer trigger + same outputs as V_OK/V_MIN_PED
-			restart_ttc(V_MIN_TIME);
-		case V_OK:						// same outputs as V_MIN_PED
-		case V_MIN_PED:					// open gate, set GREEN light
-			open_gate();
-			set_traffic_light(G);
-			break;
-
-		/***************************** TRAIN STATES *********************************/
-		case Y_TRAIN:					// open gate, set YELLOW light, load LIGHT_TIME timer trigger
-			restart_ttc(LIGHT_TIME);
-			open_gate();
-			set_traffic_light(Y);
-			break;
-		case TRAIN:						// close gate & print, set PED light, set RED light
-			close_gate();
-			printf("Gate is closed!\n");
-			set_ped_light(LED_ON);
-			set_traffic_light(R);
-			break;
-		case PED_TRAIN:					// open gate, set PED light, set RED light, load PED_TIME timer trigger
-			restart_ttc(PED_TIME);
-			open_gate();
-			printf("Gate is open!\n");
-			set_ped_light(LED_ON);
-			set_traffic_light(R);
-			break;
+static void generate_outputs(fsm_t *fsm) {
+	const output_t *out = &outputs[fsm->state];
+
+	if (out->trigger > 0) restart_ttc(fsm, out->trigger);
+	if (out->gate == GATE_OPEN) fsm->outv.gate = OPEN;
+	else if (out->gate == GATE_CLOSE) fsm->outv.gate = CLOSED;
+	fsm->gateNote = (out->note >= 0);
+	fsm->outv.ped = out->ped;
+	fsm->outv.light = out->light;
+	if (out->blue) set_blue(fsm, LED_ON);
+	if (out->then >= 0) change_state(fsm, out->then);	// M_CLR moves straight on
+}
 
-		/************************** MAINTENANCE STATES *********************************/
-		case MAINTENANCE:				// same outputs as M_TRAIN
-		case M_TRAIN:					// set BLUE light, load BLUE_TIME timer trigger (for toggling)
-			set_blue(LED_ON);
-			restart_ttc(BLUE_TIME);
-			break;
-		case M_CLR:						// no outputs, immediately change state on default transition
-			change_state(DEFAULT);
-			break;
-		default:
-			break;
+/*
+ * log the state's note once the gate has got there, "Gate is closed!" only
+ * when it is
+ */
+static void gate_check(fsm_t *fsm) {
+	if (fsm->gateNote && fsm->ops->gate_arrived(fsm)) {
+		trace(outputs[fsm->state].note, 0, 0, 0);
+		fsm->gateNote = false;
 	}
 }
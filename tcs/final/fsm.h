@@ -32,8 +32,8 @@
 #define M_TRAIN		10
 #define M_CLR		11
 
-#define M_STATES (state == MAINTENANCE || state == M_TRAIN || state == M_CLR)
-#define T_STATES (state == TRAIN || state == M_TRAIN || state == Y_TRAIN)
+#define M_STATES(s) ((s) == MAINTENANCE || (s) == M_TRAIN || (s) == M_CLR)
+#define T_STATES(s) ((s) == TRAIN || (s) == M_TRAIN || (s) == Y_TRAIN)
 
 // interrupt timing in secs
 #define PED_TIME 	10
@@ -49,21 +49,123 @@
 #define P_BTN		4
 #define T_INT		5
 #define DEFAULT		6
+#define GATE_EVENT	7		/* not a transition, the gate got where it was sent */
+#define TIMER_EVENT	8		/* not a transition, TIMER_EVENT + n is timer n expiring */
+
+#define POT_MS			100		/* how often to move the gate to the pot in maintenance */
+#define SUBSCRIBE_MS	5000	/* how often to renew our subscription */
+
+#define FSM_QUEUE_SIZE 32	/* events the callbacks can queue ahead of fsm_run, power of 2 */
 
 // Wifi Module
-#define REQUEST_ID			0
-#define DUMMY				0
 #define SERVER_ID 			27	// server ID (based on course roster)
 #define SERVER_START_VAL	-1
 
+/******************** FSM CONTEXT **************************/
+
+typedef struct fsm fsm_t;
+
+/*
+ * everything an FSM does to the world; the board's go straight to the
+ * drivers (c.f. fsm_board.c), a host simulator supplies its own to run any
+ * number of FSMs in one process (c.f. sim/corridor.c)
+ */
+typedef struct {
+	void (*timer_start)(fsm_t *fsm, u32 timer, u32 ms, bool periodic);
+	void (*timer_stop)(fsm_t *fsm, u32 timer);
+	bool (*timer_take)(fsm_t *fsm, u32 timer);		/* c.f. ttc_timer_take */
+	void (*commit)(fsm_t *fsm, const traffic_out_t *out);
+	bool (*gate_arrived)(fsm_t *fsm);
+	void (*pot)(fsm_t *fsm, bool on);				/* sample the pot, in maintenance */
+	u32 (*manual_gate)(fsm_t *fsm);					/* gate position the pot asks for */
+	void (*send)(fsm_t *fsm, void *addr, u32 size);	/* a request to the server */
+} fsm_ops_t;
+
+/*
+ * one intersection's FSM; only fsm.c writes it
+ */
+struct fsm {
+	const fsm_ops_t *ops;
+	int id;							/* our id at the server */
+	int state;						/* current FSM state */
+	bool blueStatus;				/* LED6 Blue-light status (On/Off) */
+	traffic_out_t outv;				/* outputs as of the current event, committed once it's run */
+	bool init;						/* no server value yet */
+	int remoteTrans;
+	int remoteVersion;
+	bool gateNote;					/* the state's note waits on the gate */
+
+	// events posted by the callbacks, run by fsm_step
+	s8 events[FSM_QUEUE_SIZE];
+	u32 evHead;						/* next slot to write, only the poster stores it */
+	u32 evTail;						/* next slot to read, only fsm_step stores it */
+	u32 evDropped;
+};
+
+#define FSM_INITIALIZER(o, i) { .ops = (o), .id = (i), .state = PEDESTRIAN, .blueStatus = LED_OFF, \
+	.outv = { OFF, LED_OFF, SERVO_POS(SERVO_MID) }, .init = true }
+
+/*
+ * set up fsm to drive ops as server id id, queue empty
+ */
+void fsm_init(fsm_t *fsm, const fsm_ops_t *ops, int id);
+
+/*
+ * ask the server for our value & have changes pushed to us, renewed every
+ * SUBSCRIBE_MS
+ */
+void fsm_connect(fsm_t *fsm);
+
+/*
+ * enter PEDESTRIAN & drive its outputs
+ */
+void fsm_start(fsm_t *fsm);
+
+/*
+ * queue a transition, GATE_EVENT, TIMER_EVENT + timer or DONE for fsm_step;
+ * safe from ISRs & the main loop alike
+ */
+void fsm_post(fsm_t *fsm, int event);
+
+/*
+ * a complete message from the server, posting the transition it asks for
+ */
+void fsm_server(fsm_t *fsm, const server_msg_t *msg);
+
+/*
+ * run the queued events, in order
+ */
+void fsm_step(fsm_t *fsm);
+
+/*
+ * true if there are queued events fsm_step hasn't run yet
+ */
+bool fsm_queued(const fsm_t *fsm);
+
 /******************** FUNCTION DECLARATIONS **************************/
 
-// Peripheral Callbacks
-void ttc_callback(void);
-void btn_callback(u32 btn);
-void sw_callback(u32 sw);
-void update_response_callback(u8 buffer);
+// Peripheral Callbacks, for the board's FSM (c.f. fsm_board.c)
+void ttc_callback(u32 timer);
+void btn_callback(const io_edge_t *edge);
+void sw_callback(const io_edge_t *edge);
+void gate_callback(u32 pos);
+void update_response_callback(server_msg_t *msg);
 
 // exposed FSM functions
 int get_state(void);
 void init_state(void);
+
+/*
+ * run the events the callbacks queued, in order; call from the main loop
+ */
+void fsm_run(void);
+
+/*
+ * true if the callbacks queued events fsm_run hasn't run yet
+ */
+bool fsm_pending(void);
+
+/*
+ * number of events lost because the queue was full
+ */
+u32 fsm_events_dropped(void);
@@ -0,0 +1,114 @@
+/*
+ * fsm_board.c -- the board's FSM (c.f. fsm.c), driving the peripherals and
+ * fed by their callbacks
+ */
+
+#include "fsm.h"
+
+/****************************** DRIVERS *****************************/
+
+static void timer_start(fsm_t *fsm, u32 timer, u32 ms, bool periodic) {
+	(void)fsm;
+	ttc_timer_start(timer, ms, periodic);
+}
+
+static void timer_stop(fsm_t *fsm, u32 timer) {
+	(void)fsm;
+	ttc_timer_stop(timer);
+}
+
+static bool timer_take(fsm_t *fsm, u32 timer) {
+	(void)fsm;
+	return ttc_timer_take(timer);
+}
+
+static void commit(fsm_t *fsm, const traffic_out_t *out) {
+	(void)fsm;
+	traffic_commit(out);
+}
+
+static bool arrived(fsm_t *fsm) {
+	(void)fsm;
+	return gate_arrived();
+}
+
+static void pot(fsm_t *fsm, bool on) {
+	(void)fsm;
+	if (on) adc_pot_start();
+	else adc_pot_stop();
+}
+
+static u32 pot_gate(fsm_t *fsm) {
+	(void)fsm;
+	return manual_gate();
+}
+
+static void send(fsm_t *fsm, void *addr, u32 size) {
+	(void)fsm;
+	uart_send(WIFI_DEV, addr, size);
+}
+
+static const fsm_ops_t ops = { timer_start, timer_stop, timer_take, commit, arrived, pot, pot_gate, send };
+
+// the callbacks can post before init_state, so it's ready from the start
+static fsm_t board = FSM_INITIALIZER(&ops, SERVER_ID);
+
+/****************************** PERIPHERAL CALLBACKS *******************************/
+
+void ttc_callback(u32 timer) {
+	fsm_post(&board, TIMER_EVENT + timer);
+}
+
+void btn_callback(const io_edge_t *edge) {
+	if (!edge->hi) return;		// act on presses only
+
+	if (edge->pin == 3)
+		fsm_post(&board, DONE);
+	else if (edge->pin == 0 || edge->pin == 1)
+		fsm_post(&board, P_BTN);
+}
+
+void gate_callback(u32 pos) {
+	(void)pos;
+	fsm_post(&board, GATE_EVENT);
+}
+
+void sw_callback(const io_edge_t *edge) {
+	u32 sw = edge->pin;
+	bool hi = edge->hi;
+
+	if (sw == 0 && hi) 	  	 fsm_post(&board, M_SW_HI);
+	else if (sw == 0 && !hi) fsm_post(&board, M_SW_LO);
+	else if (sw == 1 && hi)  fsm_post(&board, T_SW_HI);
+	else if (sw == 1 && !hi) fsm_post(&board, T_SW_LO);
+}
+
+void update_response_callback(server_msg_t *msg) {
+	fsm_server(&board, msg);
+}
+
+/************************************** MAIN LOOP ********************************/
+
+void init_state(void) {
+	fsm_connect(&board);
+
+	printf("Starting in Pedestrian state!\n");
+	sleep(1);
+	fsm_start(&board);
+}
+
+int get_state(void) {
+	return board.state;
+}
+
+void fsm_run(void) {
+	fsm_step(&board);
+}
+
+bool fsm_pending(void) {
+	return fsm_queued(&board);
+}
+
+u32 fsm_events_dropped(void) {
+	return board.evDropped;
+}
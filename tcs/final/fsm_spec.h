@@ -0,0 +1,71 @@
+/*
+ * fsm_spec.h -- transition specification for fsm.c
+ *
+ * Edit this, not fsm_table.h, then regenerate the table (from final/):
+ *    gcc -I. -I../sim/include -o fsmgen ../sim/fsmgen.c && ./fsmgen > fsm_table.h
+ *
+ * Rules are applied in order, so a later rule overrides an earlier one for
+ * the same state & transition; a state with no rule for a transition stays put.
+ */
+#pragma once
+
+#include "fsm.h"
+
+// every state and transition, in the order of their values in fsm.h
+#define FSM_STATES(X) \
+	X(PEDESTRIAN) X(Y2G) X(V_MIN) X(V_OK) X(V_MIN_PED) X(Y2R) \
+	X(Y_TRAIN) X(TRAIN) X(PED_TRAIN) \
+	X(MAINTENANCE) X(M_TRAIN) X(M_CLR)
+
+#define FSM_TRANSITIONS(X) \
+	X(M_SW_HI) X(M_SW_LO) X(T_SW_HI) X(T_SW_LO) X(P_BTN) X(T_INT) X(DEFAULT)
+
+// sets of states and of transitions
+#define S(state) 	(1U << (state))
+#define T(trans) 	(1U << (trans))
+#define ANY_STATE 	(S(M_CLR + 1) - 1)
+#define ANY_TRANS 	(T(DEFAULT + 1) - 1)
+#define M_SET 		(S(MAINTENANCE) | S(M_TRAIN) | S(M_CLR))		/* c.f. M_STATES */
+#define T_SET 		(S(TRAIN) | S(M_TRAIN) | S(Y_TRAIN))			/* c.f. T_STATES */
+
+/*
+ * RULE(from states, on transitions, to state)
+ */
+#define FSM_RULES(RULE) \
+	/* general states */ \
+	RULE(S(PEDESTRIAN), 	T(T_INT), 		Y2G) \
+	RULE(S(Y2G), 			T(T_INT), 		V_MIN) \
+	RULE(S(Y2R), 			T(T_INT), 		PEDESTRIAN) \
+	RULE(S(V_MIN), 			T(T_INT), 		V_OK) \
+	RULE(S(V_MIN), 			T(P_BTN), 		V_MIN_PED) \
+	RULE(S(V_OK), 			T(P_BTN), 		Y2R) \
+	RULE(S(V_MIN_PED), 		T(T_INT), 		Y2R) \
+	/* train states */ \
+	RULE(S(TRAIN), 			T(M_SW_HI), 	M_TRAIN) \
+	RULE(S(TRAIN), 			T(T_SW_LO), 	PED_TRAIN) \
+	RULE(S(Y_TRAIN), 		T(M_SW_HI), 	M_TRAIN) \
+	RULE(S(Y_TRAIN), 		T(T_INT), 		TRAIN) \
+	RULE(S(Y_TRAIN), 		T(T_SW_LO), 	PED_TRAIN) \
+	RULE(S(PED_TRAIN), 		T(T_SW_HI), 	TRAIN) \
+	RULE(S(PED_TRAIN), 		T(T_INT), 		Y2G) \
+	/* maintenance states */ \
+	RULE(S(MAINTENANCE), 	T(T_SW_HI), 	M_TRAIN) \
+	RULE(S(MAINTENANCE), 	T(M_SW_LO), 	PEDESTRIAN) \
+	RULE(S(M_TRAIN), 		T(T_SW_LO), 	M_CLR) \
+	RULE(S(M_TRAIN), 		T(M_SW_LO), 	TRAIN) \
+	RULE(S(M_CLR), 			ANY_TRANS, 		MAINTENANCE) \
+	RULE(S(M_CLR), 			T(T_SW_HI), 	M_TRAIN) \
+	/* train arriving 2nd highest precedence (ignored in maintenance and PED_TRAIN/TRAIN) */ \
+	RULE(ANY_STATE & ~(M_SET | S(PED_TRAIN) | S(TRAIN)), T(T_SW_HI), Y_TRAIN) \
+	/* maintenance highest precedence (ignored in train and maintenance states) */ \
+	RULE(ANY_STATE & ~(M_SET | T_SET), T(M_SW_HI), MAINTENANCE)
+
+/*
+ * ACTION(from states, on transitions): where the transition's action runs
+ * (c.f. transition_action in fsm.c), whatever the next state is
+ */
+#define FSM_ACTIONS(ACTION) \
+	ACTION(ANY_STATE & ~M_SET, 				T(M_SW_HI)) 	/* maintenance entry */ \
+	ACTION(M_SET, 							T(M_SW_LO)) 	/* maintenance exit */ \
+	ACTION(ANY_STATE & ~(M_SET | S(Y_TRAIN)), T(T_SW_HI)) 	/* train arriving, restart the timer */ \
+	ACTION(T_SET, 							T(T_SW_LO)) 	/* train clearing */
@@ -0,0 +1,28 @@
+/*
+ * fsm_table.h -- generated by sim/fsmgen.c from fsm_spec.h, do not edit
+ *
+ * fsmTable[state][transition] is the next state, or'd with FSM_ACT if the
+ * transition's action runs (c.f. fsm_spec.h)
+ */
+#pragma once
+
+#define FSM_NUM_STATES 12
+#define FSM_NUM_TRANS  7
+#define FSM_NEXT_MASK  0x0F
+#define FSM_ACT        0x10
+
+static const u8 fsmTable[FSM_NUM_STATES][FSM_NUM_TRANS] = {
+	/*                   M_SW_HI   M_SW_LO   T_SW_HI   T_SW_LO   P_BTN     T_INT     DEFAULT   */
+	/* PEDESTRIAN   */ { 0x19,     0x00,     0x16,     0x00,     0x00,     0x01,     0x00 },
+	/* Y2G          */ { 0x19,     0x01,     0x16,     0x01,     0x01,     0x02,     0x01 },
+	/* V_MIN        */ { 0x19,     0x02,     0x16,     0x02,     0x04,     0x03,     0x02 },
+	/* V_OK         */ { 0x19,     0x03,     0x16,     0x03,     0x05,     0x03,     0x03 },
+	/* V_MIN_PED    */ { 0x19,     0x04,     0x16,     0x04,     0x04,     0x05,     0x04 },
+	/* Y2R          */ { 0x19,     0x05,     0x16,     0x05,     0x05,     0x00,     0x05 },
+	/* Y_TRAIN      */ { 0x1A,     0x06,     0x06,     0x18,     0x06,     0x07,     0x06 },
+	/* TRAIN        */ { 0x1A,     0x07,     0x17,     0x18,     0x07,     0x07,     0x07 },
+	/* PED_TRAIN    */ { 0x19,     0x08,     0x17,     0x08,     0x08,     0x01,     0x08 },
+	/* MAINTENANCE  */ { 0x09,     0x10,     0x0A,     0x09,     0x09,     0x09,     0x09 },
+	/* M_TRAIN      */ { 0x0A,     0x17,     0x0A,     0x1B,     0x0A,     0x0A,     0x0A },
+	/* M_CLR        */ { 0x09,     0x19,     0x0A,     0x09,     0x09,     0x09,     0x09 },
+};
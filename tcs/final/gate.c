@@ -0,0 +1,113 @@
+/*
+ * gate.c -- slew rate limited gate motion (c.f. gate.h)
+ */
+
+#include "gate.h"
+#include "ttc.h"			/* profile timer */
+#include "xil_exception.h"	/* masking interrupts */
+#include "xpseudo_asm.h"	/* cpsr access */
+
+// the profile in steps << 8, per tick
+#define Q 			8
+#define SPEED_Q 	((s32)(((u64)GATE_SPEED << Q) * GATE_TICK_MS / 1000))
+#define ACCEL_Q 	((s32)(((u64)GATE_ACCEL << Q) * GATE_TICK_MS * GATE_TICK_MS / 1000000))
+#define ACCEL_MIN 	(ACCEL_Q > 0 ? ACCEL_Q : 1)
+
+static void (*saved_arrived)(u32 pos);
+
+static s32 pos;					/* steps << Q */
+static s32 vel;					/* steps << Q per tick, signed */
+static u32 target;
+static bool moving = false;		/* the profile is running */
+static bool settled = true;		/* at target & the settle time is up */
+
+static s32 iabs(s32 x) {
+	return (x < 0) ? -x : x;
+}
+
+/*
+ * one profile step: brake if stopping now only just gets us there, else
+ * speed up towards the top speed; returns true when at the target
+ */
+static bool step(void) {
+	s32 goal = (s32)target << Q;
+	s32 dist = iabs(goal - pos);
+	s32 dir = (goal > pos) ? 1 : -1;
+	s32 speed = vel * dir;			/* towards the goal, negative if heading away */
+
+	if (dist == 0) {
+		vel = 0;
+		return true;
+	}
+
+	if (speed > 0 && dist <= speed * speed / (2 * ACCEL_MIN) + speed)
+		speed = (speed - ACCEL_MIN > ACCEL_MIN) ? speed - ACCEL_MIN : ACCEL_MIN;	// brake, down to a crawl
+	else
+		speed = (speed + ACCEL_MIN > SPEED_Q) ? SPEED_Q : speed + ACCEL_MIN;
+	if (speed > dist) speed = dist;	// land on it
+
+	vel = speed * dir;
+	pos += vel;
+	if (pos == goal) {
+		vel = 0;
+		return true;
+	}
+	return false;
+}
+
+static void gate_tick(u32 timer) {
+	u32 was = gate_position();
+
+	if (!moving) {
+		// the settle time is up
+		settled = true;
+		saved_arrived(target);
+		return;
+	}
+
+	if (step()) {
+		moving = false;
+		ttc_timer_start(timer, GATE_SETTLE_MS, false);
+	}
+	if (gate_position() != was) servo_set(gate_position());
+}
+
+void gate_init(u32 start, void (*arrived)(u32 pos)) {
+	saved_arrived = arrived;
+	pos = (s32)start << Q;
+	vel = 0;
+	target = start;
+	moving = false;
+	settled = true;
+	ttc_timer_callback(TIMER_GATE, &gate_tick);
+}
+
+void gate_move(u32 to) {
+	if (to > SERVO_STEPS) return;
+
+	// the profile runs in the ttc interrupt, so save & restore the mask
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	target = to;
+	// already there, as far as the profile goes, is left to settle if it hasn't
+	if (moving || gate_position() != to) {
+		if (!moving) ttc_timer_start(TIMER_GATE, GATE_TICK_MS, true);
+		moving = true;
+		settled = false;
+	}
+
+	mtcpsr(cpsr);
+}
+
+bool gate_arrived(void) {
+	return settled;
+}
+
+u32 gate_position(void) {
+	return (u32)((pos + (1 << (Q - 1))) >> Q);
+}
+
+u32 gate_target(void) {
+	return target;
+}
@@ -0,0 +1,47 @@
+/*
+ * gate.h -- slew rate limited gate motion
+ *
+ * gate_move() sets a target; a ttc timer then walks the servo there every
+ * GATE_TICK_MS on a trapezoidal profile, speeding up and slowing down at
+ * GATE_ACCEL up to GATE_SPEED, so the gate never jumps from end to end.
+ * The servo has no position feedback, so the gate counts as there once the
+ * profile has finished and GATE_SETTLE_MS more have passed; the arrived
+ * callback says so. The timer only runs while the gate is moving.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"		/* types used by xilinx */
+#include "servo.h"			/* positions */
+
+#ifndef GATE_SPEED
+#define GATE_SPEED 		1000	/* top speed, servo steps per second */
+#endif
+#ifndef GATE_ACCEL
+#define GATE_ACCEL 		2000	/* steps per second per second */
+#endif
+#define GATE_TICK_MS 	20		/* profile step, one servo pwm period */
+#define GATE_SETTLE_MS 	100		/* allowance for the servo to catch up */
+
+/*
+ * start at the position servo_init left the servo in; arrived is called
+ * from the timer interrupt with the position each time a move settles
+ */
+void gate_init(u32 pos, void (*arrived)(u32 pos));
+
+/*
+ * head for target (0 to SERVO_STEPS) from wherever the gate is, at
+ * whatever speed it has; a target the gate is already at is no move
+ */
+void gate_move(u32 target);
+
+/*
+ * true once the gate is at its target & settled
+ */
+bool gate_arrived(void);
+
+/*
+ * where the servo is being driven right now, & where it's headed
+ */
+u32 gate_position(void);
+u32 gate_target(void);
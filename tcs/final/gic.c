@@ -11,6 +11,100 @@
 static XScuGic gic;					/* the gic instance */
 static XScuGic_Config *gic_config;	/* the gic configuration */
 
+#if GIC_PROFILE
+#include <stdio.h>
+#include <stdbool.h>
+#include "xreg_cortexa9.h"			/* pmu registers */
+#include "xpseudo_asm.h"			/* mfcp & mtcp */
+
+#define PMCR_E 		0x1U			/* pmu: enable the counters */
+#define PMCNTEN_C 	0x80000000U		/* pmu: the cycle counter */
+#define NO_SLOT 0xFF
+#define SPURIOUS_ID 1023U			/* what the hi-pending register reads with nothing pending */
+
+/*
+ * one profiled interrupt id; the wrapper is connected with the slot as its
+ * device and calls the real handler in between two cycle counter reads
+ */
+typedef struct {
+	u32 id;
+	Xil_InterruptHandler handler;
+	void *devp;
+	u32 count;
+	u32 min;						/* duration, cycles */
+	u32 max;
+	u64 sum;
+	u32 pendingSince;				/* seen pending behind another handler at this time */
+	bool waiting;
+	u32 hist[GIC_PROFILE_BUCKETS];	/* latency, log2 cycles */
+} profile_t;
+
+static profile_t slots[GIC_PROFILE_SLOTS];
+static u32 numSlots = 0;
+static u8 slotOf[XSCUGIC_MAX_NUM_INTR_INPUTS];
+static u32 irqEntry;				/* cycle count when the irq exception was taken */
+
+static inline u32 cycles(void) {
+	return mfcp(XREG_CP15_PERF_CYCLE_COUNTER);
+}
+
+/*
+ * registered in place of XScuGic_InterruptHandler to stamp the exception entry
+ */
+static void profile_entry(void *gicp) {
+	irqEntry = cycles();
+	XScuGic_InterruptHandler((XScuGic*)gicp);
+}
+
+static void profile_handler(void *slotp) {
+	profile_t *p = (profile_t*)slotp;
+	u32 start = cycles();
+	u32 latency, duration, end, pend;
+	int b;
+
+	p->handler(p->devp);
+	end = cycles();
+
+	/*
+	 * latency counts from the exception entry, or from when we saw it waiting
+	 * behind another handler; time spent masked in the main loop isn't visible
+	 */
+	latency = start - (p->waiting ? p->pendingSince : irqEntry);
+	p->waiting = false;
+	for(b = 0; b < GIC_PROFILE_BUCKETS - 1 && (latency >> b) != 0; b++);
+	p->hist[b]++;
+
+	duration = end - start;
+	if(p->count == 0 || duration < p->min) p->min = duration;
+	if(duration > p->max) p->max = duration;
+	p->sum += duration;
+	p->count++;
+
+	/* whatever is pending now has been waiting on us */
+	pend = XScuGic_CPUReadReg(&gic, XSCUGIC_HI_PEND_OFFSET) & XSCUGIC_ACK_INTID_MASK;
+	if(pend != SPURIOUS_ID && pend < XSCUGIC_MAX_NUM_INTR_INPUTS && slotOf[pend] != NO_SLOT && !slots[slotOf[pend]].waiting) {
+		slots[slotOf[pend]].pendingSince = start;
+		slots[slotOf[pend]].waiting = true;
+	}
+}
+
+/*
+ * the slot for id, claiming one if it has none yet; NULL when they're all taken
+ */
+static profile_t *profile_slot(u32 id) {
+	if(id >= XSCUGIC_MAX_NUM_INTR_INPUTS)
+		return NULL;
+	if(slotOf[id] == NO_SLOT) {
+		if(numSlots == GIC_PROFILE_SLOTS)
+			return NULL;
+		slotOf[id] = (u8)numSlots;
+		slots[numSlots].id = id;
+		numSlots++;
+	}
+	return &slots[slotOf[id]];
+}
+#endif
+
 
 /*
  * Public Interface
@@ -25,8 +119,17 @@ s32 gic_init(void) {
 	/* initialize it */
 	if(XScuGic_CfgInitialize(&gic,gic_config,gic_config->CpuBaseAddress) != XST_SUCCESS)
 		return XST_FAILURE;
+#if GIC_PROFILE
+	/* start the pmu cycle counter & stamp every irq on its way in */
+	for(u32 id = 0; id < XSCUGIC_MAX_NUM_INTR_INPUTS; id++)
+		slotOf[id] = NO_SLOT;
+	mtcp(XREG_CP15_PERF_MONITOR_CTRL, mfcp(XREG_CP15_PERF_MONITOR_CTRL) | PMCR_E);
+	mtcp(XREG_CP15_COUNT_ENABLE_SET, PMCNTEN_C);
+	Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,(Xil_ExceptionHandler)profile_entry,&gic);
+#else
 	/* register the exception handler */
 	Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,(Xil_ExceptionHandler)XScuGic_InterruptHandler,&gic);
+#endif
 	/* enable exceptions */
 	Xil_ExceptionEnable();
 	return XST_SUCCESS;
@@ -36,6 +139,16 @@ s32 gic_init(void) {
  * Connect an interrupt id to handler and device
  */
 s32 gic_connect(u32 id, Xil_InterruptHandler handler,  void *devp) {
+#if GIC_PROFILE
+	/* wrap the handler, falling back to a direct connection once out of slots */
+	profile_t *p = profile_slot(id);
+	if(p != NULL) {
+		p->handler = handler;
+		p->devp = devp;
+		handler = profile_handler;
+		devp = p;
+	}
+#endif
 	/* associate handler with the interrupt id */
 	if(XScuGic_Connect(&gic,id,handler,devp) != XST_SUCCESS)
 		return XST_FAILURE;
@@ -60,3 +173,35 @@ void gic_close(void) {
 	XScuGic_Stop(&gic);
 }
 
+/*
+ * Dump the profile over uart1
+ */
+void gic_profile_dump(void) {
+#if GIC_PROFILE
+	u32 hz = XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 1000000;	/* cycles per us */
+	int b;
+
+	printf("irq   count      min us     mean us      max us\n");
+	for(u32 i = 0; i < numSlots; i++) {
+		profile_t *p = &slots[i];
+		if(p->count == 0)
+			continue;
+		printf("%3u %7u %11.3f %11.3f %11.3f\n", (unsigned)p->id, (unsigned)p->count,
+			(double)p->min / hz, (double)p->sum / p->count / hz, (double)p->max / hz);
+	}
+	for(u32 i = 0; i < numSlots; i++) {
+		profile_t *p = &slots[i];
+		if(p->count == 0)
+			continue;
+		printf("irq %u latency:\n", (unsigned)p->id);
+		for(b = 0; b < GIC_PROFILE_BUCKETS; b++) {
+			if(p->hist[b] == 0)
+				continue;
+			if(b < GIC_PROFILE_BUCKETS - 1)
+				printf("  <  %9.3f us %7u\n", (double)(1U << b) / hz, (unsigned)p->hist[b]);
+			else
+				printf("  >= %9.3f us %7u\n", (double)(1U << (b - 1)) / hz, (unsigned)p->hist[b]);
+		}
+	}
+#endif
+}
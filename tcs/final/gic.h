@@ -10,6 +10,16 @@
 #include "xgpio.h"			/* axi gpio details */
 #include "xuartps.h"		/* ps uart details */
 
+/*
+ * 1 to time every handler connected through gic_connect with the cpu cycle
+ * counter: per interrupt min/max/mean duration and a latency histogram
+ */
+#ifndef GIC_PROFILE
+#define GIC_PROFILE 0
+#endif
+#define GIC_PROFILE_SLOTS 	8		/* interrupt ids that can be profiled */
+#define GIC_PROFILE_BUCKETS 24		/* latency histogram, bucket b counts [2^(b-1), 2^b) cycles */
+
 /*
  * Initialize the gic
  *
@@ -35,3 +45,9 @@ void gic_disconnect(u32 id);
  * Close the gic
  */
 void gic_close(void);
+
+/*
+ * Print each profiled interrupt's duration stats and latency histogram to
+ * stdout (uart1); a no-op unless GIC_PROFILE is set
+ */
+void gic_profile_dump(void);
@@ -4,103 +4,125 @@
  */
 
 #include "io.h"
-
-// callback functions for btn and sw
-static void (*saved_btn_callback)(u32 btn);
-static void (*saved_sw_callback)(u32 btn);
-
-// the button/switch port XGpio reference
-static XGpio btnport;		/* btn GPIO port instance */
-static XGpio swport;		/* sw GPIO port instance */
-
-/* hidden private state */
-static u32 currSwStates;		/* keep track of current state of switch port (gpio dev 2) */
+#include "ttc.h"			/* debounce windows */
+#include "rec.h"			/* field recorder */
 
 /* useful definitions */
 #define INPUT 1				/* Set direction of GPIO Port pins */
 #define CHANNEL1 1			/* which channel of GPIO device */
 
+// a debounced port: the first edge masks its interrupt & opens a window,
+// the level at the end of the window is what counts
+typedef struct {
+	XGpio gpio;				/* GPIO port instance */
+	u16 deviceId;
+	u32 timer;				/* ttc timer for the window */
+	u32 states;				/* levels as of the last window, what the callbacks have seen */
+	XTime first;			/* when the window's first edge came in */
+	u32 suppressed;			/* interrupts that didn't become an edge of their own */
+	void (*callback)(const io_edge_t *edge);
+} port_t;
+
+static port_t btnport;		/* gpio dev 1 */
+static port_t swport;		/* gpio dev 2 */
+
 /******************************* STATIC FUNCTIONS ***********************************/
 
 /*
- * Gets position of MS set bit, 0-indexed
- *
+ * deliver an edge for every bit set in diff, lowest pin first; one count
+ * trailing zeros per edge, however many pins changed at once
  */
-static u32 oneHotDecoder(u32 portData){
-	u32 pos = 0;
-	while(portData != 1){
-		portData >>= 1;
-		pos++;
+static void edges(u32 diff, u32 states, XTime when, void (*callback)(const io_edge_t *edge)) {
+	io_edge_t edge;
+
+	edge.when = when;
+	while (diff != 0) {
+		edge.pin = (u32)__builtin_ctz(diff);
+		edge.hi = (states >> edge.pin) & 1;
+		diff &= diff - 1;		// clear the lowest set bit
+		callback(&edge);
 	}
-	return pos;
 }
 
 /*
- * control is passed to this function when a button is pushed
+ * control is passed to this function on the first edge of a button push or
+ * switch flip; the rest of the bounce is left to the window
  *
- * devicep -- ptr to the device that caused the interrupt
+ * devicep -- ptr to the port that caused the interrupt
  */
-static void btn_handler(void *devicep) {
-	/* coerce the generic pointer into a gpio */
-	XGpio *dev = (XGpio*)devicep;
-
-	u32 portStatus = XGpio_DiscreteRead(dev, CHANNEL1) & 0xF;
-	/* Read buttons for high, then act on it */
-	if(portStatus > 0){
-		// which button was pressed?
-		saved_btn_callback(oneHotDecoder(portStatus));
-	}
+static void gpio_handler(void *devicep) {
+	/* coerce the generic pointer into a port */
+	port_t *port = (port_t*)devicep;
 
-	// always clear interrupt after handling it
-	XGpio_InterruptClear(dev, XGPIO_IR_CH1_MASK);
+	// mask the port until it settles, the window's timer unmasks it
+	XGpio_InterruptDisable(&port->gpio, XGPIO_IR_CH1_MASK);
+	XGpio_InterruptClear(&port->gpio, XGPIO_IR_CH1_MASK);
+
+	XTime_GetTime(&port->first);
+	ttc_timer_start(port->timer, IO_DEBOUNCE_MS, false);
 }
 
 /*
- * control is passed to this function when a switch is flipped
- *
- * devicep -- ptr to the device that caused the interrupt
+ * the window is over: deliver what changed since the last window & unmask
  */
-static void sw_handler(void *devicep) {
-	/* coerce the generic pointer into a gpio */
-	XGpio *dev = (XGpio*)devicep;
+static void settle(port_t *port) {
+	u32 nextStates = XGpio_DiscreteRead(&port->gpio, CHANNEL1) & 0xF;
+	u32 diff = nextStates ^ port->states;
 
-	u32 nextStates = XGpio_DiscreteRead(dev, CHANNEL1) & 0xF;
-	u32 diff = nextStates ^ currSwStates;
+	// the port moved again inside the window, and/or came back to where it was
+	if (XGpio_InterruptGetStatus(&port->gpio) & XGPIO_IR_CH1_MASK) port->suppressed++;
+	if (diff == 0) port->suppressed++;
 
-	// update curr switch states
-	currSwStates = nextStates;
-
-	if(diff > 0){
-		// which switch was toggled?
-		saved_sw_callback(oneHotDecoder(diff));
-	}
+	if (diff != 0) rec_gpio(port->deviceId, nextStates, port->first);
+	port->states = nextStates;
+	edges(diff, nextStates, port->first, port->callback);
 
 	// always clear interrupt after handling it
-	XGpio_InterruptClear(dev, XGPIO_IR_CH1_MASK);
+	XGpio_InterruptClear(&port->gpio, XGPIO_IR_CH1_MASK);
+	XGpio_InterruptEnable(&port->gpio, XGPIO_IR_CH1_MASK);
 }
 
-/******************************* MODULE FUNCTIONS **********************************/
+static void window_expired(u32 timer) {
+	settle((timer == btnport.timer) ? &btnport : &swport);
+}
 
 /*
- * initialize the btns providing a callback
+ * set up a port (c.f. module 1) with its interrupts on
  */
-void io_btn_init(void (*btn_callback)(u32 btn)){
-	saved_btn_callback = btn_callback;
+static void port_init(port_t *port, u16 deviceId, u32 intr, u32 timer, void (*callback)(const io_edge_t *edge)) {
+	port->callback = callback;
+	port->deviceId = deviceId;
+	port->timer = timer;
+	port->suppressed = 0;
+	ttc_timer_callback(timer, &window_expired);
+
+	/* initialize the port and immediately disable interrupts */
+	XGpio_Initialize(&port->gpio, deviceId);
+	XGpio_SetDataDirection(&port->gpio, CHANNEL1, INPUT);
 
-	/* initialize btnport (c.f. module 1) and immediately disable interrupts */
-	XGpio_Initialize(&btnport, XPAR_AXI_GPIO_1_DEVICE_ID);
-	XGpio_SetDataDirection(&btnport, CHANNEL1, INPUT);
+	XGpio_InterruptDisable(&port->gpio, XGPIO_IR_CH1_MASK);
+	XGpio_InterruptGlobalDisable(&port->gpio);
 
-	XGpio_InterruptDisable(&btnport, XGPIO_IR_CH1_MASK);
-	XGpio_InterruptGlobalDisable(&btnport);
+	// Set the initial state for the handler
+	port->states = XGpio_DiscreteRead(&port->gpio, CHANNEL1) & 0xF;
 
 	/* connect handler to the gic (c.f. gic.h) */
-	gic_connect(XPAR_FABRIC_GPIO_1_VEC_ID, &btn_handler, (void*) &btnport);
+	gic_connect(intr, &gpio_handler, (void*) port);
 
 	/* enable interrupts on channel (c.f. table 2.1) */
-	XGpio_InterruptEnable(&btnport, XGPIO_IR_CH1_MASK);
+	XGpio_InterruptClear(&port->gpio, XGPIO_IR_CH1_MASK);
+	XGpio_InterruptEnable(&port->gpio, XGPIO_IR_CH1_MASK);
 	/* enable interrupt to processor (c.f. table 2.1) */
-	XGpio_InterruptGlobalEnable(&btnport);
+	XGpio_InterruptGlobalEnable(&port->gpio);
+}
+
+/******************************* MODULE FUNCTIONS **********************************/
+
+/*
+ * initialize the btns providing a callback
+ */
+void io_btn_init(void (*btn_callback)(const io_edge_t *edge)){
+	port_init(&btnport, XPAR_AXI_GPIO_1_DEVICE_ID, XPAR_FABRIC_GPIO_1_VEC_ID, TIMER_BTN, btn_callback);
 }
 
 /*
@@ -108,40 +130,22 @@ void io_btn_init(void (*btn_callback)(u32 btn)){
  */
 void io_btn_close(void){
 	// disconnect the interrupts for gpio device 1 (aka buttons for module 2)
+	ttc_timer_stop(TIMER_BTN);
 	gic_disconnect(XPAR_FABRIC_GPIO_1_VEC_ID);
 }
 
 /*
  * initialize the switches providing a callback
  */
-void io_sw_init(void (*sw_callback)(u32 sw)){
-	// save the sw callback
-	saved_sw_callback = sw_callback;
-
-	/* initialize swport and immediately disable interrupts */
-	XGpio_Initialize(&swport, XPAR_AXI_GPIO_2_DEVICE_ID);
-	XGpio_SetDataDirection(&swport, CHANNEL1, INPUT);
-
-	XGpio_InterruptDisable(&swport, XGPIO_IR_CH1_MASK);
-	XGpio_InterruptGlobalDisable(&swport);
-
-	/* connect handler to the gic (c.f. gic.h) */
-	gic_connect(XPAR_FABRIC_GPIO_2_VEC_ID, &sw_handler, (void*) &swport);
-
-	/* enable interrupts on channel (c.f. table 2.1) */
-	XGpio_InterruptEnable(&swport, XGPIO_IR_CH1_MASK);
-	/* enable interrupt to processor (c.f. table 2.1) */
-	XGpio_InterruptGlobalEnable(&swport);
-
-	// Set the initial sw state for sw handler
-	currSwStates = XGpio_DiscreteRead(&swport, CHANNEL1) & 0xF;
+void io_sw_init(void (*sw_callback)(const io_edge_t *edge)){
+	port_init(&swport, XPAR_AXI_GPIO_2_DEVICE_ID, XPAR_FABRIC_GPIO_2_VEC_ID, TIMER_SW, sw_callback);
 }
 
 /*
  * read the sw and return current sw states
  */
 u32 io_sw_read(void) {
-	return currSwStates;
+	return swport.states;
 }
 
 /*
@@ -149,5 +153,14 @@ u32 io_sw_read(void) {
  */
 void io_sw_close(void){
 	// disconnect the interrupts for gpio device 2 (aka switches for module 2)
+	ttc_timer_stop(TIMER_SW);
 	gic_disconnect(XPAR_FABRIC_GPIO_2_VEC_ID);
 }
+
+u32 io_btn_suppressed(void) {
+	return btnport.suppressed;
+}
+
+u32 io_sw_suppressed(void) {
+	return swport.suppressed;
+}
@@ -1,6 +1,10 @@
 /*
  * io.h -- switch and button module interface
  *
+ * Inputs are debounced: the first edge on a port masks its interrupt and
+ * opens an IO_DEBOUNCE_MS window on a ttc timer, and the levels at the end
+ * of the window are compared with the last window's. One bouncing push or
+ * flip thus makes one edge, however many interrupts it would have raised.
  */
 #pragma once
 
@@ -9,12 +13,27 @@
 #include <xgpio.h>		  	/* axi gpio */
 #include "xparameters.h"  	/* constants used by the hardware */
 #include "xil_types.h"		/* types used by xilinx */
+#include "xtime_l.h"		/* global timer, edge timestamps */
 #include "gic.h"			/* General Interrupt Controller module */
 
+#ifndef IO_DEBOUNCE_MS
+#define IO_DEBOUNCE_MS 	20		/* window after a first edge before the level counts */
+#endif
+
+/*
+ * one input changing level; every pin that changed over a debounce window
+ * gets its own edge, in pin order, stamped with the window's first edge
+ */
+typedef struct {
+	u32 pin;			/* button or switch number */
+	bool hi;			/* level after the edge, true = pressed / up */
+	XTime when;			/* global timer at the first edge of the actuation */
+} io_edge_t;
+
 /*
- * initialize the btns providing a callback
+ * initialize the btns providing a callback, called for presses & releases
  */
-void io_btn_init(void (*btn_callback)(u32 btn));
+void io_btn_init(void (*btn_callback)(const io_edge_t *edge));
 
 /*
  * close the btns
@@ -29,10 +48,16 @@ u32 io_sw_read(void);
 /*
  * initialize the switches providing a callback
  */
-void io_sw_init(void (*sw_callback)(u32 sw));
+void io_sw_init(void (*sw_callback)(const io_edge_t *edge));
 
 /*
  * close the switches
  */
 void io_sw_close(void);
 
+/*
+ * interrupts that were bounce rather than an edge of their own: windows
+ * that ended where they started, and windows the port kept moving in
+ */
+u32 io_btn_suppressed(void);
+u32 io_sw_suppressed(void);
@@ -5,15 +5,21 @@
  */
 
 #include "led.h"
+#include "rec.h"		/* field recorder */
 
 static XGpio port;		// led 0-3
 static XGpio port6; 	// led 6
 static XGpioPs portPs; 	// led 4
 
+// what we last wrote to each axi port, so changing a bit needs no read back
+static u32 portBits = 0;
+static u32 port6Bits = 0;
+
 void led_init(void) {
 	// AXI-GPIO device0: led0-3
 	XGpio_Initialize(&port, XPAR_AXI_GPIO_0_DEVICE_ID);	/* initialize device AXI_GPIO_0 */
 	XGpio_SetDataDirection(&port, CHANNEL1, OUTPUT);	    /* set tristate buffer to output */
+	XGpio_DiscreteWrite(&port, CHANNEL1, portBits);		/* start from a known shadow */
 
 	// PS7-GPIO device0: led4
 	XGpioPs_CfgInitialize(&portPs, XGpioPs_LookupConfig(XPAR_PS7_GPIO_0_DEVICE_ID), XPAR_PS7_GPIO_0_BASEADDR); // XPAR_PS7_GPIO_0_BASEADDR
@@ -22,6 +28,8 @@ void led_init(void) {
 }
 
 void led_set(u32 led, bool tostate) {
+	rec_led(led, tostate);
+
 	// handle led4 separately
 	if (led == 4 || led == ALL) {
 		XGpioPs_WritePin(&portPs, MIO7, tostate ? 0x1 : 0x0);
@@ -29,13 +37,14 @@ void led_set(u32 led, bool tostate) {
 	}
 
 	// set 4 leds
-	u32 prev = XGpio_DiscreteRead(&port, CHANNEL1);
+	u32 prev = portBits;
 	u32 mask = (led == ALL) ? 0xF : (0x1 << led); // either all leds, bitshift 1 to the correct led
 
 	if (tostate) mask |= prev; // OR with the previous bit states
 	else mask = ~mask & prev;  // 0-out mask, then AND in order to 0 out the correct leds
 
-	XGpio_DiscreteWrite(&port, CHANNEL1, mask);
+	if (mask != prev) XGpio_DiscreteWrite(&port, CHANNEL1, mask);
+	portBits = mask;
 
 	// turn off port6
 	//if (!tostate && led == ALL)
@@ -46,7 +55,7 @@ void led_set(u32 led, bool tostate) {
 bool led_get(u32 led) {
 	if (led == 4) return XGpioPs_ReadPin(&portPs, MIO7) == 0x1;
 
-	u32 bits = XGpio_DiscreteRead(&port, CHANNEL1); // current state of port
+	u32 bits = portBits; // current state of port
 	u32 mask = (0x1 << led); // used to read the specific bit
 	return ((mask & bits) > 0) ? LED_ON : LED_OFF; // if was on, then value would be greater than 0
 }
@@ -55,7 +64,9 @@ void led_toggle(u32 led) {
 	//if (led == 4) XGpioPs_WritePin(&portPs, MIO7, 1 ^ XGpioPs_ReadPin(&portPs, MIO7));
 	//else XGpio_DiscreteWrite(&port, CHANNEL1, (0x1 << led) ^ XGpio_DiscreteRead(&port, CHANNEL1));
 
-	XGpio_DiscreteWrite(&port, CHANNEL1, (0x1 << led) ^ XGpio_DiscreteRead(&port, CHANNEL1));
+	portBits ^= (0x1 << led);
+	XGpio_DiscreteWrite(&port, CHANNEL1, portBits);
+	rec_led(led, (portBits >> led) & 0x1);
 }
 
 void led_close(void) {
@@ -63,8 +74,12 @@ void led_close(void) {
 }
 
 void led6_set(u32 color){
-	u32 mask = XGpio_DiscreteRead(&port6, CHANNEL1) & ~(W);
-	XGpio_DiscreteWrite(&port6, CHANNEL1, color | mask); // rmw
+	u32 bits = (port6Bits & ~(W)) | color; // modify the shadow, no read
+	if (bits != port6Bits) {
+		XGpio_DiscreteWrite(&port6, CHANNEL1, bits);
+		rec_led6(bits);
+	}
+	port6Bits = bits;
 }
 
 void led6_close(void) {
@@ -75,4 +90,5 @@ void led6_init(void){
 	// AXI-GPIO device1: led6
 	XGpio_Initialize(&port6, XPAR_AXI_GPIO_3_DEVICE_ID);	/* initialize device AXI_GPIO_3 */
 	XGpio_SetDataDirection(&port6, CHANNEL1, OUTPUT);	    /* set tristate buffer to output */
+	XGpio_DiscreteWrite(&port6, CHANNEL1, port6Bits);		/* start from a known shadow */
 }
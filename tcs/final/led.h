@@ -1,6 +1,8 @@
 /*
  * led.h -- led module interface
  *
+ * The axi ports are write-only as far as we're concerned: led.c keeps a
+ * shadow of what it last wrote and only writes a port when that changes.
  */
 #pragma once
 
@@ -0,0 +1,144 @@
+/*
+ * rec.c -- field recorder (c.f. rec.h)
+ */
+
+#include <stdio.h>
+#include "xil_exception.h"	/* masking interrupts */
+#include "xpseudo_asm.h"	/* cpsr access */
+#include "rec.h"
+
+#if REC_ENABLE
+#define REC_MAX_BYTES 	(1 + 10 + REC_UART_MAX)	/* largest record: header, time, payload */
+
+static u8 buf[REC_BUF_SIZE];
+static u32 len = 0;
+static u64 last = 0;				/* time of the previous record */
+
+static u32 varint(u8 *p, u64 v) {
+	u32 n = 0;
+
+	while (v >= 0x80) {
+		p[n++] = (u8)(v | 0x80);
+		v >>= 7;
+	}
+	p[n++] = (u8)v;
+	return n;
+}
+
+/*
+ * append one record stamped with when; ISRs and the main loop both record,
+ * so the append runs with interrupts masked
+ */
+static void put(u8 type, u32 arg, XTime when, const u8 *payload, u32 n) {
+	u8 rec[REC_MAX_BYTES];
+	u64 t = when >> REC_TIME_SHIFT;
+	s64 delta;
+	u32 size, i;
+
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	if (len == 0) {
+		const u8 header[REC_HEADER_SIZE] = { 'T', 'C', 'S', 'R', REC_VERSION, REC_TIME_SHIFT, 0, 0 };
+		for (i = 0; i < REC_HEADER_SIZE; i++) buf[i] = header[i];
+		len = REC_HEADER_SIZE;
+	}
+
+	delta = (s64)(t - last);
+	rec[0] = (u8)(type | (arg << REC_TYPE_BITS));
+	size = 1 + varint(rec + 1, ((u64)delta << 1) ^ (u64)(delta >> 63));
+	for (i = 0; i < n; i++) rec[size++] = payload[i];
+
+	// once full, stop for good so what we have stays consistent
+	if (!(buf[6] & REC_TRUNCATED)) {
+		if (len + size > REC_BUF_SIZE) buf[6] |= REC_TRUNCATED;
+		else {
+			for (i = 0; i < size; i++) buf[len + i] = rec[i];
+			len += size;
+			last = t;
+		}
+	}
+
+	mtcpsr(cpsr);
+}
+
+static void put_now(u8 type, u32 arg, const u8 *payload, u32 n) {
+	XTime now;
+
+	XTime_GetTime(&now);
+	put(type, arg, now, payload, n);
+}
+#endif
+
+void rec_gpio(u16 deviceId, u32 levels, XTime when) {
+#if REC_ENABLE
+	u8 p[5];
+	put(REC_GPIO, deviceId, when, p, varint(p, levels));
+#endif
+}
+
+void rec_uart(const u8 *bytes, u32 n) {
+#if REC_ENABLE
+	u32 chunk;
+
+	for (; n > 0; bytes += chunk, n -= chunk) {
+		chunk = (n > REC_UART_MAX) ? REC_UART_MAX : n;
+		put_now(REC_UART, chunk - 1, bytes, chunk);
+	}
+#endif
+}
+
+void rec_adc(u16 raw) {
+#if REC_ENABLE
+	u8 p[2] = { (u8)raw, (u8)(raw >> 8) };
+	put_now(REC_ADC, 0, p, 2);
+#endif
+}
+
+void rec_ttc(u32 timer) {
+#if REC_ENABLE
+	put_now(REC_TTC, timer, NULL, 0);
+#endif
+}
+
+void rec_led6(u32 color) {
+#if REC_ENABLE
+	put_now(REC_LED6, color, NULL, 0);
+#endif
+}
+
+void rec_led(u32 led, bool on) {
+#if REC_ENABLE
+	put_now(REC_LED, ((led & 0xF) << 1) | (on ? 1 : 0), NULL, 0);
+#endif
+}
+
+void rec_servo(u32 pos) {
+#if REC_ENABLE
+	u8 p[5];
+	put_now(REC_SERVO, 0, p, varint(p, pos));
+#endif
+}
+
+const u8 *rec_data(void) {
+#if REC_ENABLE
+	return buf;
+#else
+	return NULL;
+#endif
+}
+
+u32 rec_size(void) {
+#if REC_ENABLE
+	return len;
+#else
+	return 0;
+#endif
+}
+
+void rec_dump(void) {
+#if REC_ENABLE
+	printf("recording: %u bytes at %p%s\n", (unsigned)len, (const void*)buf,
+		(buf[6] & REC_TRUNCATED) ? ", truncated" : "");
+#endif
+}
@@ -0,0 +1,83 @@
+/*
+ * rec.h -- field recorder
+ *
+ * With REC_ENABLE 1 every input the firmware acts on (debounced button &
+ * switch levels, bytes from the wifi uart, raw pot conversions), every TTC
+ * timer expiry and every output write (led6 color, leds, servo position)
+ * is appended to a RAM buffer as a compact binary record. rec_dump() says
+ * where the buffer is, to copy it off the board into a file, e.g. with
+ *    xsct% mrd -bin -file tcs.rec ADDR WORDS
+ * The host simulator saves it to $TCS_RECORD instead, and sim/recplay.c
+ * feeds a recording back through the firmware & checks that it drives the
+ * outputs the same way.
+ *
+ * A recording is an 8 byte header, then the records in the order they were
+ * written:
+ *    header  "TCSR", REC_VERSION, REC_TIME_SHIFT, flags (REC_TRUNCATED), 0
+ *    u8      type | arg << REC_TYPE_BITS
+ *    varint  time since the previous record, zigzag encoded, in global
+ *            timer counts >> REC_TIME_SHIFT
+ *    ...     payload, by type
+ * A GPIO record is written when its debounce window closes but stamped with
+ * the window's first edge, so time can step back.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"		/* types used by xilinx */
+#include "xtime_l.h"		/* global timer */
+
+#ifndef REC_ENABLE
+#define REC_ENABLE 		0			/* 1 to record */
+#endif
+#ifndef REC_BUF_SIZE
+#define REC_BUF_SIZE 	(16U << 20)	/* bytes, recording stops once full; ~2 hours of pot sampling, days without */
+#endif
+#define REC_VERSION 	1
+#define REC_TIME_SHIFT 	0			/* full global timer resolution, replays exactly */
+#define REC_HEADER_SIZE 8
+#define REC_TRUNCATED 	0x01		/* header flag: the buffer filled up */
+#define REC_TYPE_BITS 	3
+
+// record types                        arg             payload
+#define REC_GPIO 		0			/* axi gpio dev     varint levels */
+#define REC_UART 		1			/* bytes - 1        1 to 32 bytes from the wifi */
+#define REC_ADC 		2			/* 0                u16 raw pot conversion */
+#define REC_TTC 		3			/* timer            */
+#define REC_LED6 		4			/* color            */
+#define REC_LED 		5			/* led << 1 | on    (led & 0xF, ALL is 15) */
+#define REC_SERVO 		6			/* 0                varint position */
+
+#define REC_UART_MAX 	32
+
+/*
+ * inputs: levels of an axi gpio port as of when, the bytes a uart read
+ * brought in, a raw pot conversion
+ */
+void rec_gpio(u16 deviceId, u32 levels, XTime when);
+void rec_uart(const u8 *buf, u32 n);
+void rec_adc(u16 raw);
+
+/*
+ * a ttc timer expiring
+ */
+void rec_ttc(u32 timer);
+
+/*
+ * outputs, as written
+ */
+void rec_led6(u32 color);
+void rec_led(u32 led, bool on);
+void rec_servo(u32 pos);
+
+/*
+ * the recording so far, header included; 0 bytes unless REC_ENABLE
+ */
+const u8 *rec_data(void);
+u32 rec_size(void);
+
+/*
+ * print where the recording is & how big, for copying it off the board;
+ * a no-op unless REC_ENABLE
+ */
+void rec_dump(void);
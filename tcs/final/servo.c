@@ -3,36 +3,46 @@
  */
 
 #include "servo.h"
+#include "rec.h"		/* field recorder */
 
 /* Defines */
 #define CTR_MAX		0xFFFFFFFF	/* 32 bit counter, 8xF */
 #define CLOCK_FREQ	50000000	/* 50 MHz produced by FCLK_CLK0 */
 #define WAVE_PERIOD 20			/* in milliseconds */
+#define WAVE_COUNTS ((u64)CLOCK_FREQ / 1000 * WAVE_PERIOD)	/* timer counts per period */
 
 static XTmrCtr tmrCtr;
+static u32 loads[SERVO_STEPS + 1];	/* timer 1 load value for each position */
 
 /* Helper function for resetting
  * based on AXI Timer Reference Manual (PGO079) formula
  * for setting the Load register for the desired
- * PWM_period and PWM_high_time on an up-counter
+ * PWM_period and PWM_high_time on an up-counter,
+ * with the time in hundredths of a percent of the period
  */
-static u32 calcResetValue(double period){
-	return 2 + CTR_MAX - (u32)(period*1e6/XTC_HZ_TO_NS(CLOCK_FREQ));
+static u32 calcResetValue(u64 duty){
+	return 2 + CTR_MAX - (u32)(duty * WAVE_COUNTS / 10000);
 }
 
 /*
  * Initialize the servo, setting the duty cycle to 7.5%
  */
 void servo_init(void){
+	u32 pos;
+
+	// every position's load value up front, in counts so no step is rounded twice
+	for (pos = 0; pos <= SERVO_STEPS; pos++)
+		loads[pos] = calcResetValue(SERVO_MIN) - (u32)((u64)(SERVO_MAX - SERVO_MIN) * WAVE_COUNTS * pos / (10000ULL * SERVO_STEPS));
+
 	// handle initialization for timer
 	XTmrCtr_Initialize(&tmrCtr, XPAR_AXI_TIMER_0_DEVICE_ID);
 	XTmrCtr_SetOptions(&tmrCtr, XTC_TIMER_0, XTmrCtr_GetOptions(&tmrCtr, XTC_TIMER_0) | XTC_PWM_ENABLE_OPTION | XTC_EXT_COMPARE_OPTION);
 	XTmrCtr_SetOptions(&tmrCtr, XTC_TIMER_1, XTmrCtr_GetOptions(&tmrCtr, XTC_TIMER_1) | XTC_PWM_ENABLE_OPTION | XTC_EXT_COMPARE_OPTION);
 
 	// timer 0 controls the whole waveform period
-	XTmrCtr_SetResetValue(&tmrCtr, XTC_TIMER_0, calcResetValue(WAVE_PERIOD));
+	XTmrCtr_SetResetValue(&tmrCtr, XTC_TIMER_0, calcResetValue(10000));
 	// timer 1 controls the duty cycle
-	servo_set(SERVO_MID);
+	servo_set(SERVO_POS(SERVO_MID));
 
 	// start the timer
 	XTmrCtr_Start(&tmrCtr, XTC_TIMER_0);
@@ -40,19 +50,16 @@ void servo_init(void){
 }
 
 /*
- * Set the duty cycle of the servo
+ * Set the position of the servo
  */
-void servo_set(double dutycycle){
-	// dutycycle in percent
-	if (dutycycle >= SERVO_MIN && dutycycle <= SERVO_MAX)
-		XTmrCtr_SetResetValue(&tmrCtr, XTC_TIMER_1, calcResetValue(dutycycle*WAVE_PERIOD/100));
+void servo_set(u32 pos){
+	if (pos <= SERVO_STEPS) {
+		XTmrCtr_SetResetValue(&tmrCtr, XTC_TIMER_1, loads[pos]);
+		rec_servo(pos);
+	}
 }
 
-double servo_set_percent(u32 percent) {
-	double duty = -1;
-	if (percent >= 0 && percent <= 100) {
-		duty = SERVO_MIN + (SERVO_MAX - SERVO_MIN)*(float)percent/100;
-		servo_set(duty);
-	}
-	return duty;
+u32 servo_percent_pos(u32 percent) {
+	if (percent > 100) percent = 100;
+	return percent * SERVO_STEPS / 100;
 }
@@ -1,5 +1,10 @@
 /*
  * servo.h
+ *
+ * The gate is positioned in integer steps, 0 (SERVO_MIN) to SERVO_STEPS
+ * (SERVO_MAX); each step's AXI timer load value is worked out once by
+ * servo_init, so setting a position is a table lookup & a register write,
+ * no floating point.
  */
 #pragma once
 
@@ -8,17 +13,25 @@
 #include "xparameters.h"  	/* constants used by the hardware */
 #include "xil_types.h"		/* types used by xilinx */
 
-#define SERVO_MID	7.5	    /* in percent of WAVE_PERIOD */
-#define SERVO_MAX   9.75    /* tested max percent for 45-degrees */
-#define SERVO_MIN   5.25    /* tested min percent for 45-degrees */
+#define SERVO_MID	750	    /* in hundredths of a percent of WAVE_PERIOD */
+#define SERVO_MAX   975     /* tested max for 45-degrees */
+#define SERVO_MIN   525     /* tested min for 45-degrees */
+
+#define SERVO_STEPS 1000	/* positions from SERVO_MIN to SERVO_MAX, per mille */
+#define SERVO_POS(duty) 	(((duty) - SERVO_MIN) * SERVO_STEPS / (SERVO_MAX - SERVO_MIN))
+
 /*
  * Initialize the servo, setting the duty cycle to 7.5%
  */
 void servo_init(void);
 
 /*
- * Set the dutycycle of the servo
+ * Set the servo to position pos, 0 to SERVO_STEPS
+ * Does nothing if pos is out of range
  */
-void servo_set(double dutycycle);
+void servo_set(u32 pos);
 
-double servo_set_percent(u32 percent);
+/*
+ * the position percent (0 = SERVO_MIN, 100 = SERVO_MAX) stands for
+ */
+u32 servo_percent_pos(u32 percent);
@@ -15,6 +15,8 @@
 #include "xil_types.h"		/* u32, s32 etc */
 #include "xparameters.h"	/* constants used by hardware */
 #include "xgpio.h"			/* axi gpio interface */
+#include "xil_exception.h"	/* masking interrupts around wfi */
+#include "xpseudo_asm.h"	/* wfi */
 
 /*************** User-Defined Modules **************/
 #include "led.h"		/* LED Module */
@@ -25,9 +27,8 @@
 #include "adc.h"		/* adc module */
 #include "wifi.h"		/* wifi module */
 #include "fsm.h"
-
-/********************* DEFINES **********************/
-#define TTC_FREQ 10
+#include "trace.h"		/* deferred logging */
+#include "rec.h"		/* field recorder */
 
 /***************************** MAIN *************************/
 void init(void) {
@@ -40,6 +41,9 @@ void init(void) {
 	//uart initialization
 	uart_init(&update_response_callback);
 
+	// ttc initialization, before the btns & sws debounce on it
+	ttc_init(&ttc_callback);
+
 	// btn & sw initialization
 	io_btn_init(&btn_callback);
 	io_sw_init(&sw_callback);
@@ -50,17 +54,21 @@ void init(void) {
 	// led6 initialization
 	led6_init();
 
-	// ttc initialization
-	ttc_init(TTC_FREQ, &ttc_callback);
-
-	// servo initialization
+	// servo initialization, then the gate's motion from where it left the servo
 	servo_init();
+	gate_init(SERVO_POS(SERVO_MID), &gate_callback);
 
 	// XADC initialization
 	adc_init();
 }
 
 void destroy(void) {
+	// interrupt timing, when built with GIC_PROFILE (c.f. gic.h)
+	gic_profile_dump();
+	// where the field recording is, when built with REC_ENABLE (c.f. rec.h)
+	rec_dump();
+	printf("bounces suppressed: btn %u, sw %u\n", (unsigned)io_btn_suppressed(), (unsigned)io_sw_suppressed());
+
 	// close gic interrupts
 	uart_close();
 	io_sw_close();
@@ -89,8 +97,15 @@ int main(){
 	printf("[hello]\n");
 	init_state();
 	while(get_state() != DONE){
-		sleep(1);
+		// parse wifi bytes and run the FSM out of interrupt context, then sleep until the next interrupt
+		uart_poll();
+		fsm_run();
+		trace_drain();		/* lowest priority, a few records per pass */
+		Xil_ExceptionDisable();
+		if (!uart_pending() && !fsm_pending() && !trace_pending()) wfi();		/* a masked interrupt still wakes wfi */
+		Xil_ExceptionEnable();
 	}
+	while (trace_pending()) trace_drain();
 	printf("\n---- main while loop done ----\n");
 
 	// close
@@ -0,0 +1,94 @@
+/*
+ * trace.c -- deferred binary trace (c.f. trace.h)
+ */
+
+#include <stdio.h>
+#include "xil_exception.h"	/* masking interrupts */
+#include "xpseudo_asm.h"	/* cpsr access */
+#include "trace.h"
+
+#if !TRACE_BINARY
+#define TRACE_FMT(id, fmt) fmt,
+static const char *const formats[TR_NUM_EVENTS] = { TRACE_EVENTS(TRACE_FMT) };
+#undef TRACE_FMT
+#endif
+
+static trace_rec_t ring[TRACE_RING_SIZE];
+static u32 head = 0;				/* next slot to write, stored with interrupts masked */
+static u32 tail = 0;				/* next slot to read, only trace_drain stores it */
+static u32 lost = 0;				/* records dropped since the last TR_LOST */
+
+static void put(u32 time, u16 id, s16 a0, s16 a1, s16 a2) {
+	trace_rec_t *rec = &ring[head & (TRACE_RING_SIZE - 1)];
+
+	rec->time = time;
+	rec->id = id;
+	rec->args[0] = a0;
+	rec->args[1] = a1;
+	rec->args[2] = a2;
+	__atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+}
+
+void trace(u16 id, s16 a0, s16 a1, s16 a2) {
+	XTime now;
+	XTime_GetTime(&now);
+
+	// ISRs and the main loop both write, so save & restore the mask
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	u32 room = TRACE_RING_SIZE - (head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE));
+	if (lost > 0 && room >= 2) {
+		// mark the gap where it happened
+		put((u32)(now >> TRACE_TIME_SHIFT), TR_LOST, (lost > 0x7FFF) ? 0x7FFF : (s16)lost, 0, 0);
+		lost = 0;
+		room--;
+	}
+	if (lost == 0 && room > 0) put((u32)(now >> TRACE_TIME_SHIFT), id, a0, a1, a2);
+	else lost++;
+
+	mtcpsr(cpsr);
+}
+
+static void write_rec(const trace_rec_t *rec) {
+#if TRACE_BINARY
+	u8 raw[TRACE_REC_BYTES];
+	char buf[1 + TRACE_REC_CHARS];
+	int i, j;
+
+	for (i = 0; i < 4; i++) raw[i] = (u8)(rec->time >> (8 * i));
+	raw[4] = (u8)rec->id;
+	raw[5] = (u8)(rec->id >> 8);
+	for (i = 0; i < 3; i++) {
+		raw[6 + 2 * i] = (u8)rec->args[i];
+		raw[7 + 2 * i] = (u8)((u16)rec->args[i] >> 8);
+	}
+
+	// every 3 bytes as 4 characters, low bits first
+	buf[0] = TRACE_SYNC;
+	for (i = 0; i < TRACE_REC_BYTES / 3; i++) {
+		u32 w = raw[3 * i] | (u32)raw[3 * i + 1] << 8 | (u32)raw[3 * i + 2] << 16;
+		for (j = 0; j < 4; j++) buf[1 + 4 * i + j] = (char)(TRACE_CHAR_BASE + ((w >> (6 * j)) & 0x3F));
+	}
+	fwrite(buf, 1, sizeof(buf), stdout);
+#else
+	if (rec->id < TR_NUM_EVENTS) printf(formats[rec->id], rec->args[0], rec->args[1], rec->args[2]);
+	printf("\n");
+#endif
+}
+
+void trace_drain(void) {
+	trace_rec_t rec;
+	int n;
+
+	for (n = 0; n < TRACE_DRAIN_MAX && tail != __atomic_load_n(&head, __ATOMIC_ACQUIRE); n++) {
+		rec = ring[tail & (TRACE_RING_SIZE - 1)];
+		__atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+		write_rec(&rec);
+	}
+	if (n > 0) fflush(stdout);
+}
+
+bool trace_pending(void) {
+	return __atomic_load_n(&head, __ATOMIC_ACQUIRE) != tail;
+}
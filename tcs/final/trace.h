@@ -0,0 +1,72 @@
+/*
+ * trace.h -- deferred binary trace
+ *
+ * trace() drops a fixed size record (timestamp, event id, args) into a RAM
+ * ring in a few dozen cycles, from an ISR or the main loop; trace_drain()
+ * writes the records out later, when the main loop has nothing better to
+ * do. With TRACE_BINARY 0 the drain prints each record's format string,
+ * with 1 it writes each record to stdout between the usual text, for the
+ * host decoder to render (c.f. tcs/tracedump.c): TRACE_SYNC, then the
+ * record's TRACE_REC_BYTES, little endian, 6 bits to a character from
+ * TRACE_CHAR_BASE. Those characters are never '\n', '\r' or TRACE_SYNC,
+ * so the BSP's newline translation leaves them alone and a decoder can
+ * tell a damaged record and find the next.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"		/* types used by xilinx */
+#include "xtime_l.h"		/* global timer */
+
+#ifndef TRACE_BINARY
+#define TRACE_BINARY 	 0		/* 1 to write raw records instead of text */
+#endif
+#define TRACE_RING_SIZE  64		/* records buffered ahead of the drain, power of 2 */
+#define TRACE_DRAIN_MAX  8		/* records written per trace_drain call */
+#define TRACE_SYNC 		 0x1E	/* ascii record separator, precedes each raw record */
+#define TRACE_TIME_SHIFT 8		/* record time is the global timer >> 8, ~0.77us */
+#define TRACE_TICK_HZ 	 (COUNTS_PER_SECOND >> TRACE_TIME_SHIFT)
+#define TRACE_REC_BYTES  12		/* time, id & args, before encoding */
+#define TRACE_REC_CHARS  16		/* on the wire, after TRACE_SYNC: 6 bits a character */
+#define TRACE_CHAR_BASE  '0'	/* characters '0' to 'o' */
+
+/*
+ * every event: id, printf format for its (up to 3) args
+ */
+#define TRACE_EVENTS(X) \
+	X(TR_LOST, 			"[trace] %d records lost") \
+	X(TR_STATE, 		"curr state: %d, next state: %d, transition: %d") \
+	X(TR_GATE_CLOSED, 	"Gate is closed!") \
+	X(TR_GATE_OPEN, 	"Gate is open!") \
+	X(TR_M_ENTRY, 		"Maintenance entry!") \
+	X(TR_M_EXIT, 		"Maintenance exit!") \
+	X(TR_T_ARRIVING, 	"Train is arriving!") \
+	X(TR_T_CLEARING, 	"Train is clearing!")
+
+#define TRACE_ID(id, fmt) id,
+enum { TRACE_EVENTS(TRACE_ID) TR_NUM_EVENTS };
+#undef TRACE_ID
+
+/*
+ * one record, little endian & encoded on the wire after TRACE_SYNC
+ */
+typedef struct {
+	u32 time;		/* TRACE_TICK_HZ ticks since boot, wraps every ~55 minutes */
+	u16 id;
+	s16 args[3];
+} trace_rec_t;
+
+/*
+ * record an event; safe from ISRs, drops the record if the ring is full
+ */
+void trace(u16 id, s16 a0, s16 a1, s16 a2);
+
+/*
+ * write out up to TRACE_DRAIN_MAX records; call from the main loop
+ */
+void trace_drain(void);
+
+/*
+ * true if there are records trace_drain hasn't written yet
+ */
+bool trace_pending(void);
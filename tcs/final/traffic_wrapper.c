@@ -4,31 +4,19 @@
 
 #include "traffic_wrapper.h"
 
-// leds
-void set_traffic_light(u32 color) {
-	led6_set(color);
-}
-
-void close_traffic_light(void) {
-	set_traffic_light(OFF);
-}
+static traffic_out_t committed;		/* what the ports hold */
+static bool valid = false;			/* nothing committed yet */
 
-void set_blue_light(bool on_off) {
-	set_traffic_light((on_off) ? B : OFF);
-}
+void traffic_commit(const traffic_out_t *out) {
+	if (!valid || out->light != committed.light) led6_set(out->light);
+	if (!valid || out->ped != committed.ped) led_set(PED_LIGHT, out->ped);
+	if (!valid || out->gate != committed.gate) gate_move(out->gate);
 
-void set_ped_light(bool on_off) {
-	led_set(PED_LIGHT, on_off);
+	committed = *out;
+	valid = true;
 }
 
 // gate operation
-void open_gate(void) {
-	servo_set(OPEN);
-}
-void close_gate(void) {
-	servo_set(CLOSED);
-}
-
-void manual_gate(void) {
-	servo_set_percent(adc_get_pot_percent());
+u32 manual_gate(void) {
+	return servo_percent_pos(adc_get_pot_percent());
 }
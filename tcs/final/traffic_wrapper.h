@@ -1,5 +1,8 @@
 /*
  * Header file for traffic_wrapper.c
+ *
+ * The FSM describes all its outputs at once in a traffic_out_t and commits
+ * it; only the ports that differ from the last commit get written.
  */
 
 #pragma once
@@ -7,22 +10,25 @@
 #include <stdbool.h>    /* bool */
 #include "led.h"		/* LED Module for traffic/blue/ped lights */
 #include "servo.h"		/* servo module for gate */
+#include "gate.h"		/* gate motion */
 #include "adc.h"		/* adc module for potentiometer */
 
 // gate position
-#define OPEN 	SERVO_MAX
-#define CLOSED 	SERVO_MIN
+#define OPEN 	SERVO_STEPS
+#define CLOSED 	0
 
 // ped light
 #define PED_LIGHT	4
 
-// traffic lights (including blue light);
-void set_traffic_light(u32 color);
-void close_traffic_light(void);
-void set_blue_light(bool on_off);
-void set_ped_light(bool on_off);
+typedef struct {
+	u32 light;			/* led6 color, the traffic light or the blue light */
+	bool ped;			/* ped light */
+	u32 gate;			/* servo position, OPEN, CLOSED or in between */
+} traffic_out_t;
 
-// gate operation
-void open_gate(void);
-void close_gate(void);
-void manual_gate(void);
+// write out what changed since the last commit; the first commit writes everything,
+// the gate heads for its position rather than jumping there (c.f. gate.h)
+void traffic_commit(const traffic_out_t *out);
+
+// gate position the potentiometer asks for
+u32 manual_gate(void);
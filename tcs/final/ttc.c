@@ -1,71 +1,166 @@
 
 #include "ttc.h"
+#include "xil_exception.h"	/* masking interrupts */
+#include "xpseudo_asm.h"	/* cpsr access */
+#include "wheel.h"			/* timer wheel */
+#include "rec.h"			/* field recorder */
+
+#define MIN_TICKS 	2			/* soonest match we program, so the counter can't pass it first */
+#define MAX_TICKS 	0x8000		/* latest match we program, well inside one counter wrap */
 
 static XTtcPs ttcportPs;
 
-static void (*saved_ttc_callback)(void);
+static void (*saved_ttc_callback)(u32 timer);
+static void (*callbacks[TTC_NUM_TIMERS])(u32 timer);	/* per timer, NULL for saved_ttc_callback */
+
+static wheel_t wheel;			/* in ticks of the extended counter */
+static wheel_timer_t timers[TTC_NUM_TIMERS];
+static u32 periods[TTC_NUM_TIMERS];	/* ticks, 0 for one-shot */
+static u32 fired = 0;			/* timers expired & not yet taken, one bit each */
+static u64 ticks = 0;			/* the 16 bit counter extended, as of lastCount */
+static u16 lastCount = 0;
+
+/*
+ * the counter extended to 64 bits; we read it at least every MAX_TICKS while
+ * a timer is armed, and with none armed nothing depends on it
+ */
+static u64 ttc_now(void) {
+	u16 count = (u16) XTtcPs_GetCounterValue(&ttcportPs);
+	ticks += (u16)(count - lastCount);
+	lastCount = count;
+	return ticks;
+}
+
+/*
+ * program match 0 for the earliest expiry, or switch it off if there is
+ * none; the cascades on the way are done when we get there
+ */
+static void ttc_program(void) {
+	u64 now = ttc_now();
+	u64 next = wheel_expiry(&wheel);
+	u64 delta;
+
+	if (next == WHEEL_NEVER) {
+		XTtcPs_DisableInterrupts(&ttcportPs, XTTCPS_IXR_MATCH_0_MASK);
+		return;
+	}
+
+	delta = (next > now) ? next - now : 0;
+	if (delta < MIN_TICKS) delta = MIN_TICKS;
+	if (delta > MAX_TICKS) delta = MAX_TICKS;	/* wake up part way, to keep the extended count */
+	XTtcPs_SetMatchValue(&ttcportPs, 0, (u16)(lastCount + delta));
+	XTtcPs_ClearInterruptStatus(&ttcportPs, XTTCPS_IXR_MATCH_0_MASK);	/* a match passed while disabled */
+	XTtcPs_EnableInterrupts(&ttcportPs, XTTCPS_IXR_MATCH_0_MASK);
+}
+
+static void ttc_expire(wheel_timer_t *t) {
+	u32 i = (u32)(t - timers);
+
+	// keep the period's phase, skipping any we were too late for
+	if (periods[i] > 0) {
+		u64 next = t->expires + periods[i];
+		wheel_add(&wheel, t, (next <= ticks) ? ticks + periods[i] : next);
+	}
+
+	fired |= 1U << i;
+	rec_ttc(i);
+	if (callbacks[i] != NULL) callbacks[i](i);
+	else saved_ttc_callback(i);
+}
 
 static void ttc_handler(void *devicep) {
 	/* coerce the generic pointer into a ttc */
 	XTtcPs *dev = (XTtcPs*)devicep;
-	saved_ttc_callback();
 
 	// use the status returned by this dev to clear the interrupt on it
 	XTtcPs_ClearInterruptStatus(dev, XTtcPs_GetInterruptStatus(dev));
+
+	wheel_advance(&wheel, ttc_now(), &ttc_expire);
+	ttc_program();
 }
 
 /*
- * ttc_init -- initialize the ttc freqency and callback
+ * ttc_init -- start the free-running counter & set the callback
  */
-void ttc_init(u32 freq, void (*ttc_callback)(void)) {
+void ttc_init(void (*ttc_callback)(u32 timer)) {
 	saved_ttc_callback = ttc_callback;
 
 	// initialize the TTC and immediately disable interrupts
 	XTtcPs_CfgInitialize(&ttcportPs, XTtcPs_LookupConfig(XPAR_XTTCPS_0_DEVICE_ID), XPAR_XTTCPS_0_BASEADDR);
-	XTtcPs_DisableInterrupts(&ttcportPs, XTTCPS_IXR_INTERVAL_MASK);
+	XTtcPs_DisableInterrupts(&ttcportPs, XTTCPS_IXR_ALL_MASK);
 
-	XTtcPs_SetOptions(&ttcportPs, XTTCPS_OPTION_INTERVAL_MODE);
-	ttc_set_freq(freq);
+	// count up & wrap at 0xFFFF, interrupting only on a match
+	XTtcPs_SetOptions(&ttcportPs, XTTCPS_OPTION_MATCH_MODE | XTTCPS_OPTION_WAVE_DISABLE);
+	XTtcPs_SetPrescaler(&ttcportPs, TTC_PRESCALER);
 
 	/* connect handler to the gic (c.f. gic.h) */
 	gic_connect(XPAR_XTTCPS_0_INTR, &ttc_handler, (void*) &ttcportPs);
+
+	XTtcPs_Start(&ttcportPs);
+	lastCount = (u16) XTtcPs_GetCounterValue(&ttcportPs);
+	wheel_init(&wheel, ticks);
 }
 
-void ttc_set_freq(u32 freq) {
-	XInterval *interval = NULL;
-	u8 *prescaler = NULL;
-	XTtcPs_CalcIntervalFromFreq(&ttcportPs, freq, interval, prescaler);
-	XTtcPs_SetPrescaler(&ttcportPs, *prescaler);
-	XTtcPs_SetInterval(&ttcportPs, *interval);
+void ttc_timer_callback(u32 timer, void (*callback)(u32 timer)) {
+	if (timer < TTC_NUM_TIMERS) callbacks[timer] = callback;
 }
 
-/*
- * ttc_start -- start the ttc
- */
-void ttc_start(void) {
-	XTtcPs_EnableInterrupts(&ttcportPs, XTTCPS_IXR_INTERVAL_MASK);
-	XTtcPs_Start(&ttcportPs);
+void ttc_timer_start(u32 timer, u32 ms, bool periodic) {
+	u64 n = ((u64)ms * TTC_TICK_HZ + 999) / 1000;	/* round up, never early */
+
+	if (timer >= TTC_NUM_TIMERS) return;
+	if (n == 0) n = 1;
+
+	// the ISR walks the timers too, so save & restore the mask
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	wheel_del(&wheel, &timers[timer]);
+	wheel_add(&wheel, &timers[timer], ttc_now() + n);
+	periods[timer] = periodic ? (u32)n : 0;
+	fired &= ~(1U << timer);
+	ttc_program();
+
+	mtcpsr(cpsr);
 }
 
-/*
- * ttc_stop -- stop the ttc
- */
-void ttc_stop(void) {
-	XTtcPs_Stop(&ttcportPs);
-	XTtcPs_DisableInterrupts(&ttcportPs, XTTCPS_IXR_INTERVAL_MASK);
+void ttc_timer_stop(u32 timer) {
+	if (timer >= TTC_NUM_TIMERS) return;
+
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	wheel_del(&wheel, &timers[timer]);
+	fired &= ~(1U << timer);
+	ttc_program();
+
+	mtcpsr(cpsr);
 }
 
-/*
- * ttc_reset -- resets the ttc counter value
- */
-void ttc_reset(void) {
-	XTtcPs_ResetCounterValue(&ttcportPs);
+bool ttc_timer_take(u32 timer) {
+	bool was;
+
+	if (timer >= TTC_NUM_TIMERS) return false;
+
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	was = (fired & (1U << timer)) != 0;
+	fired &= ~(1U << timer);
+
+	mtcpsr(cpsr);
+	return was;
+}
+
+bool ttc_timer_armed(u32 timer) {
+	return timer < TTC_NUM_TIMERS && wheel_active(&timers[timer]);
 }
 
 /*
  * ttc_close -- close down the ttc
  */
 void ttc_close(void) {
-	XTtcPs_DisableInterrupts(&ttcportPs, XTTCPS_IXR_INTERVAL_MASK);
+	XTtcPs_DisableInterrupts(&ttcportPs, XTTCPS_IXR_ALL_MASK);
+	XTtcPs_Stop(&ttcportPs);
 	gic_disconnect(XPAR_XTTCPS_0_INTR);
 }
@@ -3,43 +3,71 @@
  *
  * NOTE: The TTC hardware must be enabled (Timer 0 on the processing system) before it can be used!!
  *
+ * Tickless software timers: the TTC counter free-runs, the timers sit on a
+ * timer wheel counting its ticks (c.f. wheel.h), and match register 0 is
+ * programmed for the wheel's next piece of work only, so with no timer
+ * running there are no TTC interrupts at all.
  */
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "xttcps.h"
 #include "xparameters.h"  	/* constants used by the hardware */
 #include "xil_types.h"		/* types used by xilinx */
 #include "gic.h"
+
+#define TTC_PRESCALER 	15		/* counter clock is the ttc clock / 2^(15+1), ~1.7 kHz */
+#define TTC_TICK_HZ 	(XPAR_XTTCPS_0_TTC_CLK_FREQ_HZ >> (TTC_PRESCALER + 1))
+#define TTC_NUM_TIMERS 	32		/* software timers, one bit each in a u32 */
+
+// software timers, one owner each
+#define TIMER_STATE	0		/* fsm: state timeout, T_INT */
+#define TIMER_BLUE	1		/* fsm: blue light blink in maintenance */
+#define TIMER_WIFI	2		/* fsm: subscription renewal */
+#define TIMER_POT	3		/* fsm: potentiometer sampling in maintenance */
+#define TIMER_BTN	4		/* io: button debounce window */
+#define TIMER_SW	5		/* io: switch debounce window */
+#define TIMER_ADC	6		/* adc: pot sampling */
+#define TIMER_GATE	7		/* gate: motion profile & settle */
+
 /*
- * ttc_init -- initialize the ttc freqency and callback
+ * ttc_init -- start the free-running counter; ttc_callback is called from
+ * the ttc interrupt with the number of each timer that expires
  */
-void ttc_init(u32 freq, void (*ttc_callback)(void));
+void ttc_init(void (*ttc_callback)(u32 timer));
 
 /*
- * ttc_set_freq -- set the frequency (Hz) of the ttc
+ * ttc_timer_callback -- call callback instead of ttc_init's when timer
+ * expires, for owners that act in the interrupt itself
  */
-void ttc_set_freq(u32 freq);
+void ttc_timer_callback(u32 timer, void (*callback)(u32 timer));
 
 /*
- * ttc_start -- start the ttc
- * simultaneously enables ttc interrupts
+ * ttc_timer_start -- (re)start timer to expire ms from now, and then every
+ * ms after that if periodic; a pending expiry of the timer is forgotten
  */
-void ttc_start(void);
+void ttc_timer_start(u32 timer, u32 ms, bool periodic);
 
 /*
- * ttc_stop -- stop the ttc
- * simultaneously disables ttc interrupts
+ * ttc_timer_stop -- stop timer, forgetting a pending expiry
  */
-void ttc_stop(void);
+void ttc_timer_stop(u32 timer);
 
 /*
- * ttc_close -- close down the ttc
- * simultaneously disables ttc interrupts
+ * ttc_timer_take -- true (once) if timer expired since it was last started,
+ * stopped or taken; lets an expiry queued before a restart be told apart
  */
-void ttc_close(void);
+bool ttc_timer_take(u32 timer);
 
 /*
- * ttc_reset -- resets the ttc counter value to 0
+ * ttc_timer_armed -- true while timer is running, i.e. started and, if
+ * one-shot, not yet expired
  */
-void ttc_reset(void);
+bool ttc_timer_armed(u32 timer);
+
+/*
+ * ttc_close -- close down the ttc
+ * simultaneously disables ttc interrupts
+ */
+void ttc_close(void);
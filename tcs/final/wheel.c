@@ -0,0 +1,154 @@
+/*
+ * wheel.c -- hierarchical hashed timer wheel (c.f. wheel.h)
+ */
+
+#include <stddef.h>
+#include "wheel.h"
+
+#define SLOT_MASK 	(WHEEL_SLOTS - 1)
+#define SPAN(level) (1ULL << (WHEEL_BITS * (level)))		/* ticks one slot on level covers */
+#define MAX_DELTA 	(SPAN(WHEEL_LEVELS) - 1)
+
+void wheel_init(wheel_t *w, u64 now) {
+	int l;
+	u32 s;
+
+	w->clk = now;
+	for (l = 0; l < WHEEL_LEVELS; l++) {
+		w->pending[l] = 0;
+		for (s = 0; s < WHEEL_SLOTS; s++) w->slots[l][s] = NULL;
+	}
+}
+
+void wheel_add(wheel_t *w, wheel_timer_t *t, u64 expires) {
+	u64 at, delta;
+	int l;
+
+	if (expires < w->clk) expires = w->clk;
+	t->expires = expires;
+
+	// too far out for the top level, park it in the top slot that comes up last
+	delta = expires - w->clk;
+	at = (delta > MAX_DELTA) ? w->clk + MAX_DELTA : expires;
+	if (delta > MAX_DELTA) delta = MAX_DELTA;
+
+	// lowest level reaching it, so its slot there isn't the one we're in
+	for (l = 0; l < WHEEL_LEVELS - 1 && delta >= SPAN(l + 1); l++)
+		;
+
+	t->level = (u8)l;
+	t->slot = (u8)((at >> (WHEEL_BITS * l)) & SLOT_MASK);
+
+	wheel_timer_t **head = &w->slots[l][t->slot];
+	t->next = *head;
+	if (t->next != NULL) t->next->pprev = &t->next;
+	t->pprev = head;
+	*head = t;
+	w->pending[l] |= 1ULL << t->slot;
+}
+
+void wheel_del(wheel_t *w, wheel_timer_t *t) {
+	if (t->pprev == NULL) return;
+
+	*t->pprev = t->next;
+	if (t->next != NULL) t->next->pprev = t->pprev;
+	if (w->slots[t->level][t->slot] == NULL) w->pending[t->level] &= ~(1ULL << t->slot);
+	t->pprev = NULL;
+	t->next = NULL;
+}
+
+/*
+ * slots from pos to the next set bit in bits, going round, 64 if none
+ */
+static u32 slots_to(u64 bits, u32 pos) {
+	u64 r = (pos == 0) ? bits : (bits >> pos) | (bits << (WHEEL_SLOTS - pos));
+	return (r == 0) ? WHEEL_SLOTS : (u32)__builtin_ctzll(r);
+}
+
+u64 wheel_next(const wheel_t *w) {
+	u64 next = WHEEL_NEVER;
+	int l;
+
+	for (l = 0; l < WHEEL_LEVELS; l++) {
+		if (w->pending[l] == 0) continue;
+
+		// the first slot boundary on this level not yet processed
+		u64 k = (w->clk + SPAN(l) - 1) >> (WHEEL_BITS * l);
+		u64 at = (k + slots_to(w->pending[l], (u32)(k & SLOT_MASK))) << (WHEEL_BITS * l);
+		if (at < next) next = at;
+	}
+	return next;
+}
+
+u64 wheel_expiry(const wheel_t *w) {
+	u64 next = WHEEL_NEVER;
+	const wheel_timer_t *t;
+	u32 n, slot;
+	int l;
+
+	// each level's first non-empty slot holds its earliest timers, except
+	// that timers parked at the top may sit ahead of their slot's span
+	for (l = 0; l < WHEEL_LEVELS; l++) {
+		u64 k = (w->clk + SPAN(l) - 1) >> (WHEEL_BITS * l);
+		u64 end;
+
+		for (n = 0; n < WHEEL_SLOTS; n++) {
+			n += slots_to(w->pending[l], (u32)((k + n) & SLOT_MASK));
+			if (n >= WHEEL_SLOTS) break;
+
+			slot = (u32)((k + n) & SLOT_MASK);
+			end = (k + n + 1) << (WHEEL_BITS * l);
+			for (t = w->slots[l][slot]; t != NULL; t = t->next)
+				if (t->expires < next) next = t->expires;
+			if (next < end) break;
+		}
+	}
+	return next;
+}
+
+/*
+ * move a whole slot onto list, a head the caller owns, so timers on it can
+ * still be deleted while the caller works through it
+ */
+static void detach(wheel_t *w, int level, u32 slot, wheel_timer_t **list) {
+	*list = w->slots[level][slot];
+	if (*list != NULL) (*list)->pprev = list;
+	w->slots[level][slot] = NULL;
+	w->pending[level] &= ~(1ULL << slot);
+}
+
+static wheel_timer_t *pop(wheel_timer_t **list) {
+	wheel_timer_t *t = *list;
+
+	*list = t->next;
+	if (*list != NULL) (*list)->pprev = list;
+	t->next = NULL;
+	t->pprev = NULL;
+	return t;
+}
+
+void wheel_advance(wheel_t *w, u64 now, void (*expire)(wheel_timer_t *t)) {
+	wheel_timer_t *list, *t;
+	u64 tick;
+	int l;
+
+	for (tick = wheel_next(w); tick <= now && tick != WHEEL_NEVER; tick = wheel_next(w)) {
+		w->clk = tick;
+
+		// higher levels first, so what they shed can carry on down this same tick
+		for (l = WHEEL_LEVELS - 1; l > 0; l--) {
+			if ((tick & (SPAN(l) - 1)) != 0) continue;
+			detach(w, l, (u32)((tick >> (WHEEL_BITS * l)) & SLOT_MASK), &list);
+			while (list != NULL) {
+				t = pop(&list);
+				wheel_add(w, t, t->expires);
+			}
+		}
+
+		// everything left in this level 0 slot expires on this tick
+		detach(w, 0, (u32)(tick & SLOT_MASK), &list);
+		w->clk = tick + 1;
+		while (list != NULL) expire(pop(&list));
+	}
+	if (now + 1 > w->clk) w->clk = now + 1;
+}
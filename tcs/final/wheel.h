@@ -0,0 +1,79 @@
+/*
+ * wheel.h -- hierarchical hashed timer wheel
+ *
+ * WHEEL_LEVELS wheels of WHEEL_SLOTS slots each; a slot on level L spans
+ * WHEEL_SLOTS^L ticks. A timer is hashed straight into the slot for its
+ * expiry on the lowest level that reaches it, so adding & cancelling are
+ * O(1) whatever the number of timers. Higher level slots are cascaded down
+ * as time reaches them. A bitmap per level finds the next non-empty slot,
+ * so the wheel can jump over idle time instead of stepping every tick
+ * (c.f. ttc.c, which only wakes for wheel_next()).
+ *
+ * Timers are caller-owned nodes; the wheel never allocates.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"		/* types used by xilinx */
+
+#define WHEEL_BITS 		6		/* 64 slots, one bitmap word per level */
+#define WHEEL_SLOTS 	(1U << WHEEL_BITS)
+#define WHEEL_LEVELS 	4		/* reaches 2^24 ticks, further expiries wait at the top */
+#define WHEEL_NEVER 	(~0ULL)
+
+typedef struct wheel_timer {
+	struct wheel_timer *next;
+	struct wheel_timer **pprev;	/* NULL when not on the wheel */
+	u64 expires;				/* tick it expires on */
+	u8 level, slot;
+} wheel_timer_t;
+
+typedef struct {
+	u64 clk;					/* next tick to process, every earlier one is done */
+	u64 pending[WHEEL_LEVELS];	/* non-empty slots, a bit each */
+	wheel_timer_t *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+} wheel_t;
+
+/*
+ * wheel_init -- empty wheel, with tick now the next to process
+ */
+void wheel_init(wheel_t *w, u64 now);
+
+/*
+ * wheel_add -- put t on the wheel to expire on tick expires, or the next
+ * tick processed if that is already past; t must not be on the wheel
+ */
+void wheel_add(wheel_t *w, wheel_timer_t *t, u64 expires);
+
+/*
+ * wheel_del -- take t off the wheel, if it is on it
+ */
+void wheel_del(wheel_t *w, wheel_timer_t *t);
+
+/*
+ * wheel_active -- true while t is on the wheel
+ */
+static inline bool wheel_active(const wheel_timer_t *t) {
+	return t->pprev != NULL;
+}
+
+/*
+ * wheel_next -- the next tick wheel_advance has work on, WHEEL_NEVER if the
+ * wheel is empty; never later than the earliest expiry, may be earlier
+ * where a higher level slot cascades
+ */
+u64 wheel_next(const wheel_t *w);
+
+/*
+ * wheel_expiry -- the earliest expiry of any timer on the wheel, WHEEL_NEVER
+ * if it is empty; walks the first non-empty slot on each level, so a tickless
+ * caller can sleep through the cascades wheel_next() stops for
+ */
+u64 wheel_expiry(const wheel_t *w);
+
+/*
+ * wheel_advance -- process every tick up to & including now, calling
+ * expire for each timer that expires, in expiry order; t is off the wheel
+ * by then, so expire may add it (or any other timer) again
+ */
+void wheel_advance(wheel_t *w, u64 now, void (*expire)(wheel_timer_t *t));
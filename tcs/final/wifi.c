@@ -3,17 +3,152 @@
  */
 
 #include "wifi.h"
+#include "rec.h"		/* field recorder */
 
 // DEFINES
 //#define TRIG_LEVEL 1
-#define UART0_BAUD 9600
-#define UART1_BAUD XUARTPS_DFT_BAUDRATE
 
 // UART Devices
 static XUartPs uart0;
 static XUartPs uart1;
 
-static void (*saved_wifi_callback)(u8 buffer);
+static void (*saved_wifi_callback)(server_msg_t *msg);
+
+// transmit queue of one uart, only touched with interrupts masked
+typedef struct {
+	XUartPs *uart;
+	u8 buf[TX_RING_SIZE];
+	u32 head;						/* next slot to write */
+	u32 tail;						/* next slot to move into the FIFO */
+	bool active;					/* TX-empty interrupt is armed */
+	u8 policy;						/* DROP_NEWEST or DROP_OLDEST */
+	u32 dropped;
+} tx_ring_t;
+
+static tx_ring_t txRings[2] = {
+	[WIFI_DEV] = { .uart = &uart0, .policy = DROP_NEWEST },	/* never send half a request */
+	[TTY] 	   = { .uart = &uart1, .policy = DROP_OLDEST },	/* keep the latest output */
+};
+
+// frame parser states
+#define RX_SYNC0	0
+#define RX_SYNC1	1
+#define RX_LEN0		2
+#define RX_LEN1		3
+#define RX_PAYLOAD	4
+#define RX_CRC0		5
+#define RX_CRC1		6
+
+// server frame being assembled from uart0
+static server_msg_t rxMsg;
+static u8 rxState = RX_SYNC0;
+static u32 rxCount = 0;
+static u16 rxLen = 0;				/* payload bytes, from the frame header */
+static u16 rxCrc = 0;				/* crc computed over length & payload */
+static u16 rxCrcRecv = 0;			/* crc sent by the server */
+static u32 rxDropped = 0;			/* frames discarded for a bad length or crc */
+
+// single producer (uart0 ISR), single consumer (uart_poll) ring of raw bytes
+static u8 rxRing[RX_RING_SIZE];
+static u32 rxHead = 0;				/* next slot to write, only the ISR stores it */
+static u32 rxTail = 0;				/* next slot to read, only uart_poll stores it */
+static u32 rxOverruns = 0;			/* bytes lost to a full ring */
+
+/*
+ * length of a server message by its type, 0 if we don't know the type
+ */
+static u32 server_msg_len(int type) {
+	switch (type) {
+		case UPDATE:	return sizeof(update_response_t);
+		case FETCH:
+		case SUBSCRIBE:	return sizeof(fetch_response_t);
+		case NOTIFY:	return sizeof(notify_t);
+		default:		return 0;
+	}
+}
+
+/*
+ * CRC-16/CCITT (poly 0x1021) of one more byte, matching the substation
+ */
+static u16 crc16_update(u16 crc, u8 byte) {
+	crc ^= (u16)byte << 8;
+	for (int i = 0; i < 8; i++)
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	return crc;
+}
+
+/*
+ * feed the next byte from the server to the frame parser, passing on each
+ * complete message; a bad frame is dropped and we go back to hunting for
+ * the sync word after its last byte. We don't rescan those bytes, so a
+ * false sync with a plausible length swallows up to a maximum-length
+ * frame's worth (sizeof(server_msg_t) + 6) and any frames starting in it
+ */
+static void server_msg_recv(u8 buffer) {
+	switch (rxState) {
+		case RX_SYNC0:
+			if (buffer == FRAME_SYNC0) rxState = RX_SYNC1;
+			break;
+		case RX_SYNC1:
+			if (buffer == FRAME_SYNC1) {
+				rxCrc = 0xFFFF;
+				rxState = RX_LEN0;
+			}
+			else if (buffer != FRAME_SYNC0) rxState = RX_SYNC0;
+			break;
+		case RX_LEN0:
+			rxLen = buffer;
+			rxCrc = crc16_update(rxCrc, buffer);
+			rxState = RX_LEN1;
+			break;
+		case RX_LEN1:
+			rxLen |= (u16)buffer << 8;
+			rxCrc = crc16_update(rxCrc, buffer);
+			rxCount = 0;
+			// a length we could never take means we locked onto a false sync
+			if (rxLen < sizeof(int) || rxLen > sizeof(server_msg_t)) {
+				rxDropped++;
+				rxState = RX_SYNC0;
+			}
+			else rxState = RX_PAYLOAD;
+			break;
+		case RX_PAYLOAD:
+			((u8*) &rxMsg)[rxCount++] = buffer;
+			rxCrc = crc16_update(rxCrc, buffer);
+			if (rxCount == rxLen) rxState = RX_CRC0;
+			break;
+		case RX_CRC0:
+			rxCrcRecv = buffer;
+			rxState = RX_CRC1;
+			break;
+		case RX_CRC1:
+			rxCrcRecv |= (u16)buffer << 8;
+			// runs in the main loop, fsm_post masks interrupts itself
+			if (rxCrcRecv == rxCrc && rxLen == server_msg_len(rxMsg.type)) saved_wifi_callback(&rxMsg);
+			else rxDropped++;
+			rxState = RX_SYNC0;
+			break;
+		default:
+			rxState = RX_SYNC0;
+			break;
+	}
+}
+
+/*
+ * move queued bytes into the tx FIFO until it is full, arming the TX-empty
+ * interrupt while bytes remain; call with interrupts masked
+ */
+static void tx_fill(tx_ring_t *tx) {
+	u32 base = tx->uart->Config.BaseAddress;
+
+	while (tx->tail != tx->head && !XUartPs_IsTransmitFull(base)) {
+		XUartPs_WriteReg(base, XUARTPS_FIFO_OFFSET, tx->buf[tx->tail & (TX_RING_SIZE - 1)]);
+		tx->tail++;
+	}
+
+	tx->active = (tx->tail != tx->head);
+	if (tx->active) XUartPs_WriteReg(base, XUARTPS_IER_OFFSET, XUARTPS_IXR_TXEMPTY);
+}
 
 static void uart0_handler(void *CallBackRef, u32 Event, unsigned int EventData){
 	// for loopback, correctly determine src and destination devices
@@ -25,13 +160,38 @@ static void uart0_handler(void *CallBackRef, u32 Event, unsigned int EventData){
 	if (Event == 3) {
 		printf("3\n");
 	}*/
-	if(Event == XUARTPS_EVENT_RECV_DATA && src == &uart0){
-		// receive byte
-		u8 buffer;
-		XUartPs_Recv(src, &buffer, TRIG_LEVEL);
+	if((Event == XUARTPS_EVENT_RECV_DATA || Event == XUARTPS_EVENT_RECV_TOUT) && src == &uart0){
+		u32 base = src->Config.BaseAddress;
+		u32 head = rxHead;
+		u32 tail = __atomic_load_n(&rxTail, __ATOMIC_ACQUIRE);
+		u32 first = head;
 
-		// pretend everything we receive is an update packet
-		saved_wifi_callback(buffer);
+		// drain the whole FIFO straight into the ring, parsing waits for uart_poll
+		while (XUartPs_IsReceiveData(base)) {
+			u8 byte = (u8) XUartPs_ReadReg(base, XUARTPS_FIFO_OFFSET);
+			if (head - tail < RX_RING_SIZE) {
+				rxRing[head & (RX_RING_SIZE - 1)] = byte;
+				head++;
+			}
+			else rxOverruns++;	/* the frame parser resyncs past the hole */
+		}
+		__atomic_store_n(&rxHead, head, __ATOMIC_RELEASE);
+
+		// the recorder gets what the parser will see, in the one or two runs the ring holds it in
+		if (REC_ENABLE && head != first) {
+			u32 at = first & (RX_RING_SIZE - 1);
+			u32 run = RX_RING_SIZE - at;
+			if (run > head - first) run = head - first;
+			rec_uart(&rxRing[at], run);
+			rec_uart(rxRing, head - first - run);
+		}
+
+		// re-arm the receive timeout for the next burst
+		XUartPs_WriteReg(base, XUARTPS_CR_OFFSET, XUartPs_ReadReg(base, XUARTPS_CR_OFFSET) | XUARTPS_CR_TORST);
+	}
+	else if(Event == XUARTPS_EVENT_SENT_DATA && src == &uart0){
+		// FIFO drained, the driver has disarmed TX-empty
+		tx_fill(&txRings[WIFI_DEV]);
 	}
 }
 
@@ -44,19 +204,23 @@ static void uart1_handler(void *CallBackRef, u32 Event, unsigned int EventData){
 		u8 buffer;
 		XUartPs_Recv(src, &buffer, TRIG_LEVEL);
 	}
+	else if(Event == XUARTPS_EVENT_SENT_DATA && src == &uart1){
+		tx_fill(&txRings[TTY]);
+	}
 }
 
-static void uart_link(void (*wifi_callback)(u8 buffer)) {
+static void uart_link(void (*wifi_callback)(server_msg_t *msg)) {
 	saved_wifi_callback = wifi_callback;
 }
 
-void uart_init(void (*wifi_callback)(u8 buffer)) {
+void uart_init(void (*wifi_callback)(server_msg_t *msg)) {
 	// UART 0
 	XUartPs_CfgInitialize(&uart0, XUartPs_LookupConfig(XPAR_PS7_UART_0_DEVICE_ID), XPAR_PS7_UART_0_BASEADDR);
 	XUartPs_DisableUart(&uart0);
 	XUartPs_SetBaudRate(&uart0, UART0_BAUD);		//Sets the baud rate for the device
-	XUartPs_SetFifoThreshold(&uart0, TRIG_LEVEL); 			//Sets the FIFO trigger threshold
-	XUartPs_SetInterruptMask(&uart0, XUARTPS_IXR_RXOVR);	//Sets the interrupt mask
+	XUartPs_SetFifoThreshold(&uart0, RX_TRIG_LEVEL); 		//Sets the FIFO trigger threshold
+	XUartPs_SetRecvTimeout(&uart0, RX_TIMEOUT);				//Sets the receive timeout
+	XUartPs_SetInterruptMask(&uart0, XUARTPS_IXR_RXOVR | XUARTPS_IXR_TOUT);	//Sets the interrupt mask
 	XUartPs_SetHandler(&uart0, (XUartPs_Handler) uart0_handler, (void*) &uart0);
 
 	// hookup handler to gic
@@ -82,9 +246,76 @@ void uart_close(void) {
 	gic_disconnect(XPAR_XUARTPS_1_INTR);
 }
 
+void uart_poll(void) {
+	u32 tail = rxTail;
+	u32 head = __atomic_load_n(&rxHead, __ATOMIC_ACQUIRE);
+
+	while (tail != head) {
+		// replies and pushes share the stream, sort them out by type
+		server_msg_recv(rxRing[tail & (RX_RING_SIZE - 1)]);
+		tail++;
+		__atomic_store_n(&rxTail, tail, __ATOMIC_RELEASE);
+		head = __atomic_load_n(&rxHead, __ATOMIC_ACQUIRE);
+	}
+}
+
+bool uart_pending(void) {
+	return __atomic_load_n(&rxHead, __ATOMIC_ACQUIRE) != rxTail;
+}
+
+u32 uart_frames_dropped(void) {
+	return rxDropped;
+}
+
+u32 uart_rx_overruns(void) {
+	return rxOverruns;
+}
+
 void uart_send(u8 dev, void* addr, u32 size) {
-	XUartPs* dest = (dev) ? &uart1 : &uart0;
+	tx_ring_t *tx = &txRings[(dev) ? TTY : WIFI_DEV];
+	u8 *bytes = (u8*)addr;
+
+	// may be called from an ISR or the main loop, so save & restore the mask
+	u32 cpsr = mfcpsr();
+	Xil_ExceptionDisable();
+
+	u32 room = TX_RING_SIZE - (tx->head - tx->tail);
+	if (size > room) {
+		if (tx->policy == DROP_NEWEST) {
+			tx->dropped += size;
+			size = 0;
+		}
+		else {
+			// keep at most a ring's worth of the newest bytes
+			if (size > TX_RING_SIZE) {
+				tx->dropped += size - TX_RING_SIZE;
+				bytes += size - TX_RING_SIZE;
+				size = TX_RING_SIZE;
+			}
+			room = TX_RING_SIZE - (tx->head - tx->tail);
+			if (size > room) {
+				tx->dropped += size - room;
+				tx->tail += size - room;
+			}
+		}
+	}
+
+	for (u32 i = 0; i < size; i++) {
+		tx->buf[tx->head & (TX_RING_SIZE - 1)] = bytes[i];
+		tx->head++;
+	}
+
+	// an idle transmitter needs a kick, a busy one refills from its interrupt
+	if (!tx->active) tx_fill(tx);
+
+	mtcpsr(cpsr);
+}
+
+void uart_set_tx_policy(u8 dev, u8 policy) {
+	txRings[(dev) ? TTY : WIFI_DEV].policy = policy;
+}
 
-	XUartPs_Send(dest, (u8*)addr, size);
+u32 uart_tx_dropped(u8 dev) {
+	return txRings[(dev) ? TTY : WIFI_DEV].dropped;
 }
 
@@ -14,6 +14,8 @@
 #include "xuartps.h"
 #include "xparameters.h"  	/* constants used by the hardware */
 #include "xil_types.h"		/* types used by xilinx */
+#include "xil_exception.h"	/* masking interrupts */
+#include "xpseudo_asm.h"	/* cpsr access */
 #include "gic.h"
 
 /* Defines */
@@ -22,12 +24,37 @@
 //#define CONFIGURE 0
 //#define PING 	  1
 #define UPDATE 	  2
+#define FETCH 	  3		/* single id value + version, much smaller than UPDATE */
+#define SUBSCRIBE 4		/* FETCH, and the server pushes a NOTIFY on every change */
+#define NOTIFY 	  5		/* unsolicited, server to subscriber */
+
+/*
+ * or'd into a request type, the server then frames its reply (and pushes) as
+ * sync (2) | payload length (2) | payload | crc16 of length & payload (2)
+ * all little endian, so we can resynchronize after a lost or extra byte
+ */
+#define FRAMED 		0x100
+#define FRAME_SYNC0 0x5A	/* sync word 0xA55A, low byte first */
+#define FRAME_SYNC1 0xA5
 
 #define WIFI_DEV 0
 #define TTY 	 1
 
+#define UART0_BAUD 9600						/* wifi module, 8N1 */
+#define UART1_BAUD XUARTPS_DFT_BAUDRATE		/* tty */
+
 #define TRIG_LEVEL 1		/* Receive FIFO Trigger Level, in bytes */
 
+// uart0 (wifi) rx: interrupt on a mostly full FIFO or a quiet line, drain it whole
+#define RX_TRIG_LEVEL 48	/* uart0 Receive FIFO Trigger Level, in bytes (FIFO is 64) */
+#define RX_TIMEOUT 	  10	/* uart0 Receive Timeout, in 4 bit periods, flushes a frame's tail */
+#define RX_RING_SIZE  256	/* bytes buffered between the ISR and uart_poll, power of 2 */
+
+// tx: uart_send only queues, the TX-empty interrupt feeds the FIFO
+#define TX_RING_SIZE  512	/* bytes queued per uart, power of 2 */
+#define DROP_NEWEST	  0		/* when full, drop the message being sent (default for wifi) */
+#define DROP_OLDEST	  1		/* when full, make room by dropping queued bytes (default for tty) */
+
 typedef struct {
 	int type;	// must be assigned to PING
 	int id;		// must be assigned to your id
@@ -46,8 +73,78 @@ int average;
 int values[30];
 } update_response_t;
 
-void uart_init(void (*wifi_callback)(u8 buffer));
+typedef struct {
+int type; 	/* must be assigned to FETCH */
+int id;		/* id whose value we want back */
+} fetch_request_t;
+
+typedef struct {
+int type;
+int value;	/* current value at the requested id */
+int version;	/* bumped by the server on every UPDATE of the id */
+} fetch_response_t;		/* also the reply to SUBSCRIBE */
+
+typedef struct {
+int type; 	/* must be assigned to SUBSCRIBE */
+int id;		/* id we want pushed to us */
+} subscribe_request_t;
+
+typedef struct {
+int type;	/* NOTIFY */
+int id;		/* id that changed */
+int value;
+int version;
+} notify_t;
+
+/* any complete message from the server, as handed to the wifi callback */
+typedef union {
+int type;
+update_response_t update;
+fetch_response_t fetch;
+notify_t notify;
+} server_msg_t;
+
+/*
+ * initialize uart0 (wifi) and uart1 (tty); wifi_callback is called with
+ * every complete server message, replies and unsolicited NOTIFYs alike
+ */
+void uart_init(void (*wifi_callback)(server_msg_t *msg));
 
 void uart_close(void);
 
+/*
+ * queue size bytes at addr for dev (WIFI_DEV or TTY) and return at once;
+ * safe from ISRs, the bytes are copied so addr may be on the stack
+ */
 void uart_send(u8 dev, void* addr, u32 size);
+
+/*
+ * what uart_send does when dev's queue is full, DROP_NEWEST or DROP_OLDEST
+ */
+void uart_set_tx_policy(u8 dev, u8 policy);
+
+/*
+ * number of bytes dropped by dev's overflow policy
+ */
+u32 uart_tx_dropped(u8 dev);
+
+/*
+ * parse the server bytes buffered by the uart0 ISR, calling the wifi
+ * callback for each complete message; call from the main loop
+ */
+void uart_poll(void);
+
+/*
+ * true if the uart0 ISR has buffered bytes uart_poll hasn't parsed yet
+ */
+bool uart_pending(void);
+
+/*
+ * number of server frames discarded for a bad length or crc
+ */
+u32 uart_frames_dropped(void);
+
+/*
+ * number of server bytes lost because the rx ring was full
+ */
+u32 uart_rx_overruns(void);
@@ -0,0 +1,87 @@
+/*
+ * console.c -- drive the simulated board from a terminal
+ *
+ * wfi() sleeps in real time until the next TTC interval or a line on
+ * stdin, and advances simulated time by however long it actually waited.
+ * Commands are the event commands of events.c, one per line, e.g.
+ *    b 0      press button 0
+ *    s 1      flip switch 1
+ *    n 27 2 5 server pushes value 2 (version 5) for id 27
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include "sim.h"
+
+static u64 wall_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static char input[1024];			/* stdin read so far, unbuffered so select sees every line */
+static size_t inputLen = 0;
+
+/*
+ * take the next complete line out of input, false if there is none
+ */
+static bool next_line(char *line) {
+	char *nl = memchr(input, '\n', inputLen);
+	size_t len;
+
+	if (nl == NULL) return false;
+	len = (size_t)(nl - input) + 1;
+	memcpy(line, input, len);
+	line[len] = '\0';
+	memmove(input, input + len, inputLen - len);
+	inputLen -= len;
+	return true;
+}
+
+static void console_wfi(void) {
+	char line[sizeof(input) + 1];
+	u64 start = wall_ns();
+	u64 wait = sim_ttc_next();
+	u64 next = sim_next_event();
+	struct timeval tv;
+	fd_set fds;
+	ssize_t n;
+
+	// a button release or the rest of a wifi burst may be due first
+	if (next != SIM_NEVER && (wait == 0 || next - sim_now() < wait))
+		wait = (next > sim_now()) ? next - sim_now() : 1;
+	tv.tv_sec = (time_t)(wait / 1000000000ULL);
+	tv.tv_usec = (suseconds_t)(wait % 1000000000ULL / 1000);
+
+	if (!next_line(line)) {
+		FD_ZERO(&fds);
+		FD_SET(0, &fds);
+		if (select(1, &fds, NULL, NULL, (wait > 0) ? &tv : NULL) <= 0) {
+			sim_advance(wait);
+			sim_run_events();
+			return;
+		}
+		n = read(0, input + inputLen, sizeof(input) - 1 - inputLen);
+		if (n <= 0) exit(EXIT_SUCCESS);
+		inputLen += (size_t)n;
+		if (inputLen == sizeof(input) - 1) input[inputLen++] = '\n';	/* overlong line */
+		if (!next_line(line)) {
+			sim_advance(wall_ns() - start);
+			sim_run_events();
+			return;
+		}
+	}
+
+	sim_advance(wall_ns() - start);
+	sim_run_events();
+	sim_command(line);
+}
+
+__attribute__((constructor))
+static void console_init(void) {
+	sim_set_wfi(&console_wfi);
+}
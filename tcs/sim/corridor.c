@@ -0,0 +1,616 @@
+/*
+ * corridor.c -- thousands of intersections on one substation
+ *
+ * Every crossing runs the firmware's own FSM (final/fsm.c, one fsm_t each)
+ * against simulated timers, lights and gate, all in virtual time, and is
+ * connected to a shared virtual substation: the server the crossings
+ * subscribe to, which also dispatches the trains running down the rail
+ * lines & the maintenance windows, by writing each crossing's id.
+ *
+ * Time runs in epochs of EPOCH_MS. Within one every worker thread runs its
+ * share of the crossings on their own; the crossings' requests are queued
+ * and, once all the workers are through, the substation answers them and
+ * makes the epoch's dispatches, its replies & NOTIFYs landing one epoch
+ * after they were asked for or written. Every crossing draws from its own
+ * random stream, so the results don't depend on the number of threads.
+ *
+ * Vehicles arrive at each crossing at random, queue while the light isn't
+ * green and leave one every SAT_HEADWAY_MS while it is; pedestrians press
+ * the button at random. At the end the corridor's vehicle throughput &
+ * wait, pedestrian wait, FSM activity and the messages through the
+ * substation are printed.
+ *
+ * Build & run from final/:
+ *    gcc -O2 -I. -I../sim/include -pthread -o ../corridor fsm.c ../sim/corridor.c -lm
+ *    ../corridor [crossings [threads [hours]]]
+ * 10000 crossings, as many threads as cpus & 1 hour by default.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "fsm.h"
+#include "trace.h"
+
+#define EPOCH_MS 		100ULL			/* substation round trip */
+#define LINE_LEN 		100				/* crossings on a rail line, in order */
+#define TRAIN_HEADWAY_MS (15 * 60000ULL)	/* a train down every line this often */
+#define TRAIN_STEP_MS 	40000ULL		/* from one crossing to the next */
+#define TRAIN_OCCUPY_MS 60000ULL		/* T_SW_HI to T_SW_LO at a crossing */
+#define MAINT_EVERY_MS 	(4 * 3600000ULL)	/* each crossing's maintenance window comes round */
+#define MAINT_MS 		(15 * 60000ULL)
+#define VEH_PER_HOUR 	300				/* arrivals at a crossing */
+#define SAT_HEADWAY_MS 	2000ULL			/* a queued vehicle leaves this often while green */
+#define PED_PER_HOUR 	20				/* button presses at a crossing */
+#define GATE_SWING_MS 	1350ULL			/* OPEN <-> CLOSED, then GATE_SETTLE_MS, c.f. gate.h */
+
+#define FSM_TIMERS 		(TIMER_POT + 1)	/* the fsm's timers, c.f. ttc.h */
+#define MAILBOX_SIZE 	8				/* server messages in flight to a crossing */
+#define FRAME_BYTES 	6				/* sync, length & crc around a server message, c.f. wifi.c */
+#define NEVER 			UINT64_MAX
+#define MS_PER_HOUR 	3600000.0
+
+typedef struct {
+	u64 events, states;					/* fsm events posted, change_states */
+	u64 maint, trains, closures;		/* maintenance entries, trains arriving, gate closed */
+	u64 vehArrived, vehLeft, vehWaitMs;	/* wait is the queue length integrated over time */
+	u64 maxQueue;
+	u64 pedPresses, pedServed, pedWaitMs;
+} stats_t;
+
+typedef struct {
+	u64 at;
+	server_msg_t msg;
+} mail_t;
+
+typedef struct {
+	u64 at;
+	u32 id, size;
+	int type, value;
+} request_t;
+
+typedef struct {
+	pthread_t thread;
+	u32 first, n;						/* crossings [first, first + n) */
+	request_t *out;						/* this epoch's requests, in order */
+	u32 outN, outCap;
+	stats_t stats;
+} __attribute__((aligned(64))) worker_t;
+
+typedef struct {
+	fsm_t fsm;							/* first, the ops get their crossing from it */
+	worker_t *worker;					/* the one running it */
+	u64 now;							/* ms, the event being handled */
+	u64 bootAt;							/* the crossings power up over a subscription period */
+	u64 rng;
+
+	// simulated peripherals
+	u64 deadline[FSM_TIMERS];
+	u32 period[FSM_TIMERS];				/* 0 for one-shot */
+	u32 expired;						/* a bit per timer, c.f. ttc_timer_take */
+	u64 gateAt;							/* when the gate gets where it was sent, NEVER once it has */
+	traffic_out_t shown;				/* as last committed */
+
+	// traffic
+	u64 vehAt;							/* vehicles accounted for up to here */
+	u64 nextArrival, nextLeave;
+	u32 queue;
+	u64 nextPed, pedSince;
+	bool pedWaiting;
+
+	// from the substation, in time order
+	mail_t mail[MAILBOX_SIZE];
+	u32 mailN;
+} crossing_t;
+
+// dispatches, a heap on time; a train & a maintenance stream per crossing
+typedef struct {
+	u64 at;
+	u32 id;
+	int value;							/* transition written */
+} dispatch_t;
+
+typedef struct {
+	int *value, *version;
+	bool *subscribed;
+	dispatch_t *heap;
+	u32 heapN;
+	u64 upMsgs, upBytes, downMsgs, downBytes, notifies, writes, mailDropped;
+} substation_t;
+
+static crossing_t *crossings;
+static u64 *wake;						/* when each crossing next has something to do, dense to skip the idle fast */
+static u32 numCrossings;
+static worker_t *workers;
+static u32 numWorkers;
+static u64 endAt;
+static substation_t sub;
+static pthread_barrier_t barrier;
+static __thread stats_t *tls;			/* the running worker's */
+
+/****************************** RANDOM *****************************/
+
+static u64 rnd(u64 *s) {
+	*s ^= *s >> 12;
+	*s ^= *s << 25;
+	*s ^= *s >> 27;
+	return *s * 0x2545F4914F6CDD1DULL;
+}
+
+// ms to the next of perHour events at random
+static u64 exp_ms(u64 *s, double perHour) {
+	double u = ((rnd(s) >> 11) + 1) * (1.0 / 9007199254740993.0);
+	return 1 + (u64)(-log(u) * MS_PER_HOUR / perHour);
+}
+
+/****************************** TRAFFIC *****************************/
+
+/*
+ * account for the vehicles up to to, the light as shown since vehAt
+ */
+static void settle(crossing_t *x, u64 to) {
+	bool green = (x->shown.light == G);
+	stats_t *st = &x->worker->stats;
+
+	for (;;) {
+		bool leave = green && x->queue > 0 && x->nextLeave < x->nextArrival;
+		u64 t = leave ? x->nextLeave : x->nextArrival;
+
+		if (t > to) break;
+		st->vehWaitMs += (u64)x->queue * (t - x->vehAt);
+		x->vehAt = t;
+		if (leave) {
+			x->queue--;
+			st->vehLeft++;
+			x->nextLeave += SAT_HEADWAY_MS;
+			continue;
+		}
+		st->vehArrived++;
+		if (green && x->queue == 0 && x->nextLeave <= t) {
+			st->vehLeft++;						// straight through
+			x->nextLeave = t + SAT_HEADWAY_MS;
+		}
+		else if (++x->queue > st->maxQueue) st->maxQueue = x->queue;
+		x->nextArrival = t + exp_ms(&x->rng, VEH_PER_HOUR);
+	}
+	st->vehWaitMs += (u64)x->queue * (to - x->vehAt);
+	x->vehAt = to;
+}
+
+/****************************** FSM OPS *****************************/
+
+static void timer_start(fsm_t *fsm, u32 timer, u32 ms, bool periodic) {
+	crossing_t *x = (crossing_t*)fsm;
+
+	x->deadline[timer] = x->now + ms;
+	x->period[timer] = periodic ? ms : 0;
+	x->expired &= ~(1U << timer);
+}
+
+static void timer_stop(fsm_t *fsm, u32 timer) {
+	crossing_t *x = (crossing_t*)fsm;
+
+	x->deadline[timer] = NEVER;
+	x->expired &= ~(1U << timer);
+}
+
+static bool timer_take(fsm_t *fsm, u32 timer) {
+	crossing_t *x = (crossing_t*)fsm;
+	bool took = (x->expired & (1U << timer)) != 0;
+
+	x->expired &= ~(1U << timer);
+	return took;
+}
+
+static void commit(fsm_t *fsm, const traffic_out_t *out) {
+	crossing_t *x = (crossing_t*)fsm;
+
+	settle(x, x->now);
+	if (out->light == G && x->shown.light != G) x->nextLeave = x->now + SAT_HEADWAY_MS;	// first away after a start-up delay
+	if (out->ped && !x->shown.ped && x->pedWaiting) {
+		x->worker->stats.pedServed++;
+		x->worker->stats.pedWaitMs += x->now - x->pedSince;
+		x->pedWaiting = false;
+	}
+	if (out->gate != x->shown.gate) {
+		u32 d = (out->gate > x->shown.gate) ? out->gate - x->shown.gate : x->shown.gate - out->gate;
+		x->gateAt = x->now + GATE_SETTLE_MS + (GATE_SWING_MS * d + SERVO_STEPS - 1) / SERVO_STEPS;
+	}
+	x->shown = *out;
+}
+
+static bool arrived(fsm_t *fsm) {
+	return ((crossing_t*)fsm)->gateAt == NEVER;
+}
+
+static void pot(fsm_t *fsm, bool on) {
+	(void)fsm;
+	(void)on;
+}
+
+// the crew leave the pot where the gate is
+static u32 pot_gate(fsm_t *fsm) {
+	return ((crossing_t*)fsm)->shown.gate;
+}
+
+static void send(fsm_t *fsm, void *addr, u32 size) {
+	crossing_t *x = (crossing_t*)fsm;
+	worker_t *w = x->worker;
+	request_t *r;
+
+	if (w->outN == w->outCap) {
+		w->outCap = w->outCap ? w->outCap * 2 : 1024;
+		if ((w->out = realloc(w->out, w->outCap * sizeof(request_t))) == NULL) {
+			perror("corridor");
+			exit(EXIT_FAILURE);
+		}
+	}
+	r = &w->out[w->outN++];
+	r->at = x->now;
+	r->id = (u32)fsm->id;
+	r->size = size;
+	r->type = ((int*)addr)[0] & ~FRAMED;
+	r->value = (r->type == UPDATE) ? ((update_request_t*)addr)->value : 0;
+}
+
+static const fsm_ops_t ops = { timer_start, timer_stop, timer_take, commit, arrived, pot, pot_gate, send };
+
+/*
+ * the FSM's trace, counted per worker
+ */
+void trace(u16 id, s16 a0, s16 a1, s16 a2) {
+	(void)a0;
+	(void)a1;
+	(void)a2;
+	if (tls == NULL) return;
+	switch (id) {
+		case TR_STATE: 			tls->states++; break;
+		case TR_M_ENTRY: 		tls->maint++; break;
+		case TR_T_ARRIVING: 	tls->trains++; break;
+		case TR_GATE_CLOSED: 	tls->closures++; break;
+		default: break;
+	}
+}
+
+/*
+ * fsm_post masks interrupts; a crossing is only posted to by its worker
+ */
+u32 sim_mfcpsr(void) {
+	return 0;
+}
+
+void sim_mtcpsr(u32 cpsr) {
+	(void)cpsr;
+}
+
+void Xil_ExceptionDisable(void) {
+}
+
+/****************************** CROSSINGS *****************************/
+
+static void post(crossing_t *x, int event) {
+	x->worker->stats.events++;
+	fsm_post(&x->fsm, event);
+}
+
+static u64 next_wake(const crossing_t *x) {
+	u64 t = x->nextPed;
+	u32 i;
+
+	if (x->bootAt != NEVER) return x->bootAt;
+	for (i = 0; i < FSM_TIMERS; i++) if (x->deadline[i] < t) t = x->deadline[i];
+	if (x->gateAt < t) t = x->gateAt;
+	if (x->mailN > 0 && x->mail[0].at < t) t = x->mail[0].at;
+	return t;
+}
+
+/*
+ * everything due at x->now
+ */
+static void due(crossing_t *x) {
+	u32 i;
+
+	if (x->bootAt != NEVER) {
+		x->bootAt = NEVER;
+		x->vehAt = x->now;
+		x->nextArrival = x->now + exp_ms(&x->rng, VEH_PER_HOUR);
+		x->nextPed = x->now + exp_ms(&x->rng, PED_PER_HOUR);
+		fsm_connect(&x->fsm);
+		fsm_start(&x->fsm);
+		return;
+	}
+	for (i = 0; i < FSM_TIMERS; i++) {
+		if (x->deadline[i] > x->now) continue;
+		x->deadline[i] = x->period[i] ? x->deadline[i] + x->period[i] : NEVER;
+		x->expired |= 1U << i;
+		post(x, TIMER_EVENT + i);
+	}
+	if (x->gateAt <= x->now) {
+		x->gateAt = NEVER;
+		post(x, GATE_EVENT);
+	}
+	for (i = 0; i < x->mailN && x->mail[i].at <= x->now; i++) fsm_server(&x->fsm, &x->mail[i].msg);
+	if (i > 0) {
+		memmove(x->mail, x->mail + i, (x->mailN - i) * sizeof(mail_t));
+		x->mailN -= i;
+	}
+	if (x->nextPed <= x->now) {
+		x->worker->stats.pedPresses++;
+		if (!x->pedWaiting && !x->shown.ped) {
+			x->pedWaiting = true;
+			x->pedSince = x->now;
+		}
+		post(x, P_BTN);
+		x->nextPed = x->now + exp_ms(&x->rng, PED_PER_HOUR);
+	}
+}
+
+/*
+ * run x up to end, the queued events after every wakeup
+ */
+static void run(crossing_t *x, u64 end) {
+	u64 t;
+
+	while ((t = next_wake(x)) < end) {
+		x->now = t;
+		due(x);
+		fsm_step(&x->fsm);
+	}
+	wake[x->fsm.id] = t;
+}
+
+/****************************** SUBSTATION *****************************/
+
+static void mail(u32 id, u64 at, const server_msg_t *msg, u32 size) {
+	crossing_t *x = &crossings[id];
+	u32 i;
+
+	sub.downMsgs++;
+	sub.downBytes += FRAME_BYTES + size;
+	if (x->mailN == MAILBOX_SIZE) {
+		sub.mailDropped++;
+		return;
+	}
+	for (i = x->mailN; i > 0 && x->mail[i - 1].at > at; i--) x->mail[i] = x->mail[i - 1];
+	x->mail[i].at = at;
+	x->mail[i].msg = *msg;
+	x->mailN++;
+	if (at < wake[id]) wake[id] = at;
+}
+
+static void write_id(u32 id, int value, u64 at) {
+	server_msg_t msg;
+
+	sub.writes++;
+	sub.value[id] = value;
+	sub.version[id]++;
+	if (!sub.subscribed[id]) return;
+	msg.notify = (notify_t){ NOTIFY, (int)id, value, sub.version[id] };
+	sub.notifies++;
+	mail(id, at + EPOCH_MS, &msg, sizeof(notify_t));
+}
+
+static void request(const request_t *r) {
+	server_msg_t msg;
+	u32 i, n = sizeof(msg.update.values) / sizeof(msg.update.values[0]);
+	int sum = 0;
+
+	sub.upMsgs++;
+	sub.upBytes += r->size;
+	switch (r->type) {
+		case UPDATE:
+			write_id(r->id, r->value, r->at);
+			msg.update.type = UPDATE;
+			msg.update.id = (int)r->id;
+			for (i = 0; i < n; i++) sum += msg.update.values[i] = (i < numCrossings) ? sub.value[i] : 0;
+			msg.update.average = sum / (int)n;
+			mail(r->id, r->at + EPOCH_MS, &msg, sizeof(update_response_t));
+			break;
+		case SUBSCRIBE:
+			sub.subscribed[r->id] = true;
+			msg.fetch = (fetch_response_t){ SUBSCRIBE, sub.value[r->id], sub.version[r->id] };
+			mail(r->id, r->at + EPOCH_MS, &msg, sizeof(fetch_response_t));
+			break;
+		default:
+			break;
+	}
+}
+
+static bool before(const dispatch_t *a, const dispatch_t *b) {
+	return a->at < b->at || (a->at == b->at && a->id < b->id);
+}
+
+static void heap_push(dispatch_t d) {
+	u32 i = sub.heapN++;
+
+	for (; i > 0 && before(&d, &sub.heap[(i - 1) / 2]); i = (i - 1) / 2) sub.heap[i] = sub.heap[(i - 1) / 2];
+	sub.heap[i] = d;
+}
+
+static dispatch_t heap_pop(void) {
+	dispatch_t top = sub.heap[0], last = sub.heap[--sub.heapN];
+	u32 i = 0, c;
+
+	while ((c = 2 * i + 1) < sub.heapN) {
+		if (c + 1 < sub.heapN && before(&sub.heap[c + 1], &sub.heap[c])) c++;
+		if (!before(&sub.heap[c], &last)) break;
+		sub.heap[i] = sub.heap[c];
+		i = c;
+	}
+	sub.heap[i] = last;
+	return top;
+}
+
+/*
+ * the dispatch after d on the same stream: a train clears OCCUPY after it
+ * arrives and the next comes HEADWAY after; maintenance likewise
+ */
+static dispatch_t next_dispatch(dispatch_t d) {
+	switch (d.value) {
+		case T_SW_HI: d.at += TRAIN_OCCUPY_MS; d.value = T_SW_LO; break;
+		case T_SW_LO: d.at += TRAIN_HEADWAY_MS - TRAIN_OCCUPY_MS; d.value = T_SW_HI; break;
+		case M_SW_HI: d.at += MAINT_MS; d.value = M_SW_LO; break;
+		default: d.at += MAINT_EVERY_MS - MAINT_MS; d.value = M_SW_HI; break;
+	}
+	return d;
+}
+
+/*
+ * answer the epoch's requests in order, then write the dispatches due
+ * before end
+ */
+static void substation(u64 end) {
+	u32 i, j;
+
+	for (i = 0; i < numWorkers; i++) {
+		for (j = 0; j < workers[i].outN; j++) request(&workers[i].out[j]);
+		workers[i].outN = 0;
+	}
+	while (sub.heapN > 0 && sub.heap[0].at < end) {
+		dispatch_t d = heap_pop();
+		write_id(d.id, d.value, d.at);
+		heap_push(next_dispatch(d));
+	}
+}
+
+/****************************** MAIN *****************************/
+
+static void *work(void *arg) {
+	worker_t *w = arg;
+	u64 t;
+	u32 i;
+
+	tls = &w->stats;
+	for (t = 0; t < endAt; t += EPOCH_MS) {
+		for (i = w->first; i < w->first + w->n; i++) if (wake[i] < t + EPOCH_MS) run(&crossings[i], t + EPOCH_MS);
+		pthread_barrier_wait(&barrier);
+		if (w == &workers[0]) substation(t + EPOCH_MS);
+		pthread_barrier_wait(&barrier);
+	}
+	for (i = 0; i < w->n; i++) settle(&crossings[w->first + i], endAt);
+	return NULL;
+}
+
+static void setup(void) {
+	u32 i, lines = (numCrossings + LINE_LEN - 1) / LINE_LEN, w;
+
+	crossings = calloc(numCrossings, sizeof(crossing_t));
+	wake = calloc(numCrossings, sizeof(u64));
+	workers = calloc(numWorkers, sizeof(worker_t));
+	sub.value = calloc(numCrossings, sizeof(int));
+	sub.version = calloc(numCrossings, sizeof(int));
+	sub.subscribed = calloc(numCrossings, sizeof(bool));
+	sub.heap = calloc(2 * numCrossings, sizeof(dispatch_t));
+	if (!crossings || !wake || !workers || !sub.value || !sub.version || !sub.subscribed || !sub.heap) {
+		perror("corridor");
+		exit(EXIT_FAILURE);
+	}
+
+	for (w = 0; w < numWorkers; w++) {
+		workers[w].first = (u32)((u64)numCrossings * w / numWorkers);
+		workers[w].n = (u32)((u64)numCrossings * (w + 1) / numWorkers) - workers[w].first;
+	}
+	for (i = 0, w = 0; i < numCrossings; i++) {
+		crossing_t *x = &crossings[i];
+		u64 line = i / LINE_LEN, maintAt;
+		u32 k;
+
+		while (workers[w].first + workers[w].n <= i) w++;
+		fsm_init(&x->fsm, &ops, (int)i);
+		x->worker = &workers[w];
+		x->rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+		x->bootAt = wake[i] = rnd(&x->rng) % (SUBSCRIBE_MS + 1);
+		for (k = 0; k < FSM_TIMERS; k++) x->deadline[k] = NEVER;
+		x->gateAt = NEVER;
+		x->shown = x->fsm.outv;
+		x->nextArrival = NEVER;
+		x->nextPed = NEVER;
+
+		sub.value[i] = SERVER_START_VAL;
+		maintAt = rnd(&x->rng) % MAINT_EVERY_MS;
+		heap_push((dispatch_t){ line * TRAIN_HEADWAY_MS / lines + (i % LINE_LEN) * TRAIN_STEP_MS, i, T_SW_HI });
+		heap_push((dispatch_t){ maintAt, i, M_SW_HI });
+	}
+}
+
+static void report(double wall) {
+	stats_t s;
+	double hours = (double)endAt / MS_PER_HOUR, secs = (double)endAt / 1000.0;
+	u32 i, w;
+	u64 dropped = 0;
+
+	memset(&s, 0, sizeof(s));
+	for (w = 0; w < numWorkers; w++) {
+		const stats_t *t = &workers[w].stats;
+		s.events += t->events;
+		s.states += t->states;
+		s.maint += t->maint;
+		s.trains += t->trains;
+		s.closures += t->closures;
+		s.vehArrived += t->vehArrived;
+		s.vehLeft += t->vehLeft;
+		s.vehWaitMs += t->vehWaitMs;
+		if (t->maxQueue > s.maxQueue) s.maxQueue = t->maxQueue;
+		s.pedPresses += t->pedPresses;
+		s.pedServed += t->pedServed;
+		s.pedWaitMs += t->pedWaitMs;
+	}
+	for (i = 0; i < numCrossings; i++) dropped += crossings[i].fsm.evDropped;
+
+	printf("[corridor] %u crossings on %u threads, %.1fh simulated in %.3fs (%.0f crossing-hours/s)\n",
+		numCrossings, numWorkers, hours, wall, numCrossings * hours / wall);
+	printf("[corridor] fsm: %llu events, %llu state changes, %llu dropped; %llu trains, %llu gate closures, %llu maintenance entries\n",
+		(unsigned long long)s.events, (unsigned long long)s.states, (unsigned long long)dropped,
+		(unsigned long long)s.trains, (unsigned long long)s.closures, (unsigned long long)s.maint);
+	printf("[corridor] vehicles: %llu arrived, %llu through (%.1f/h a crossing), mean wait %.1fs, longest queue %llu\n",
+		(unsigned long long)s.vehArrived, (unsigned long long)s.vehLeft, s.vehLeft / hours / numCrossings,
+		s.vehArrived ? s.vehWaitMs / 1000.0 / s.vehArrived : 0.0, (unsigned long long)s.maxQueue);
+	printf("[corridor] pedestrians: %llu presses, %llu walks, mean wait %.1fs\n",
+		(unsigned long long)s.pedPresses, (unsigned long long)s.pedServed,
+		s.pedServed ? s.pedWaitMs / 1000.0 / s.pedServed : 0.0);
+	printf("[corridor] substation: up %.0f msg/s %.1f KB/s, down %.0f msg/s %.1f KB/s; %llu writes, %llu notifies, %llu mail dropped\n",
+		sub.upMsgs / secs, sub.upBytes / secs / 1024, sub.downMsgs / secs, sub.downBytes / secs / 1024,
+		(unsigned long long)sub.writes, (unsigned long long)sub.notifies, (unsigned long long)sub.mailDropped);
+}
+
+static double wall_s(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	double hours = (argc > 3) ? atof(argv[3]) : 1.0, start;
+	u32 w;
+
+	numCrossings = (argc > 1) ? (u32)strtoul(argv[1], NULL, 0) : 10000;
+	numWorkers = (argc > 2) ? (u32)strtoul(argv[2], NULL, 0) : (cpus > 0 ? (u32)cpus : 1);
+	endAt = (u64)(hours * MS_PER_HOUR) / EPOCH_MS * EPOCH_MS;
+	if (numCrossings == 0 || numWorkers == 0 || endAt == 0) {
+		fprintf(stderr, "usage: %s [crossings [threads [hours]]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (numWorkers > numCrossings) numWorkers = numCrossings;
+
+	setup();
+	pthread_barrier_init(&barrier, NULL, numWorkers);
+	start = wall_s();
+	for (w = 1; w < numWorkers; w++) {
+		if (pthread_create(&workers[w].thread, NULL, &work, &workers[w]) != 0) {
+			perror("pthread_create");
+			return EXIT_FAILURE;
+		}
+	}
+	work(&workers[0]);
+	for (w = 1; w < numWorkers; w++) pthread_join(workers[w].thread, NULL);
+
+	report(wall_s() - start);
+	return EXIT_SUCCESS;
+}
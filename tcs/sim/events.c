@@ -0,0 +1,225 @@
+/*
+ * events.c -- timestamped board events for the simulator
+ *
+ * events are command lines kept in a heap ordered by simulated time (ties
+ * in the order they were scheduled); a wfi hook advances time straight to
+ * the earlier of the next event and the next TTC interval, so nothing
+ * waits on a clock that isn't there. Commands:
+ *    b N              press button N (released BTN_HOLD later)
+ *    r N              release button N
+ *    s N [N..]        flip switches, all in the same instant
+ *    p PCT [NOISE]    set the potentiometer to PCT percent, +/- NOISE percent
+ *    w HEX..          raw bytes arriving from the wifi module
+ *    u ID VALUE       framed UPDATE reply, values[ID] = VALUE
+ *    f VALUE VERSION  framed SUBSCRIBE reply for our id
+ *    n ID VALUE VER   framed NOTIFY pushed by the server
+ *    ?                show the leds and the servo
+ *    q                quit
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "xparameters.h"
+#include "xadcps.h"
+#include "wifi.h"
+#include "fsm.h"
+
+#define MAXADC 		62700.0			/* pot full scale, as in adc.c */
+#define LED4_PIN 	7
+#define BTN_HOLD 	100000000ULL	/* how long a press lasts, ns */
+#define BYTE_TIME 	(10 * 1000000000ULL / UART0_BAUD)	/* one byte at 8N1 on the wifi uart, ns */
+#define RX_CHUNK 	16				/* bytes put on the wire per event, well under the FIFO */
+
+typedef struct {
+	u64 at;
+	u64 seq;						/* scheduling order, breaks ties */
+	char *line;
+} event_t;
+
+static event_t *heap = NULL;
+static u32 heapLen = 0;
+static u32 heapCap = 0;
+static u64 seq = 0;
+
+static u32 buttons = 0;
+static u32 switches = 0;
+
+static bool before(const event_t *a, const event_t *b) {
+	return (a->at != b->at) ? a->at < b->at : a->seq < b->seq;
+}
+
+void sim_schedule(u64 at, const char *line) {
+	event_t ev = { at, seq++, strdup(line) };
+	u32 i;
+
+	if (heapLen == heapCap) {
+		heapCap = heapCap ? heapCap * 2 : 64;
+		heap = realloc(heap, heapCap * sizeof(event_t));
+		if (heap == NULL) {
+			fprintf(stderr, "[sim] out of memory for events\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// sift up
+	for (i = heapLen++; i > 0 && before(&ev, &heap[(i - 1) / 2]); i = (i - 1) / 2)
+		heap[i] = heap[(i - 1) / 2];
+	heap[i] = ev;
+}
+
+static event_t pop(void) {
+	event_t top = heap[0];
+	event_t last = heap[--heapLen];
+	u32 i = 0, child;
+
+	// sift down
+	while ((child = 2 * i + 1) < heapLen) {
+		if (child + 1 < heapLen && before(&heap[child + 1], &heap[child])) child++;
+		if (!before(&heap[child], &last)) break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+	return top;
+}
+
+u64 sim_next_event(void) {
+	return heapLen ? heap[0].at : SIM_NEVER;
+}
+
+void sim_run_events(void) {
+	while (heapLen && heap[0].at <= sim_now()) {
+		event_t ev = pop();
+		sim_command(ev.line);
+		free(ev.line);
+	}
+}
+
+/*
+ * put bytes on the wifi uart a chunk at a time, at line rate, so the
+ * firmware gets to drain the FIFO in between as it would on the board
+ */
+static void wifi_rx(const u8 *bytes, u32 n) {
+	u32 now = (n < RX_CHUNK) ? n : RX_CHUNK;
+	char line[2 + 3 * 256];		/* the rest, as a "w" command */
+	u32 i, len;
+
+	sim_uart_rx(XPAR_PS7_UART_0_DEVICE_ID, bytes, now);
+	if (now == n) return;
+
+	len = (u32)snprintf(line, sizeof(line), "w");
+	for (i = now; i < n && len + 4 < sizeof(line); i++)
+		len += (u32)snprintf(line + len, sizeof(line) - len, " %02x", bytes[i]);
+	sim_schedule(sim_now() + now * BYTE_TIME, line);
+}
+
+static u16 crc16(const u8 *buf, u32 len) {
+	u16 crc = 0xFFFF;
+
+	for (u32 i = 0; i < len; i++) {
+		crc ^= (u16)buf[i] << 8;
+		for (int b = 0; b < 8; b++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/*
+ * frame a server message the way the server does for a FRAMED request
+ */
+static void wifi_rx_framed(const void *msg, u32 size) {
+	u8 frame[4 + sizeof(server_msg_t) + 2];
+	u16 crc;
+
+	frame[0] = FRAME_SYNC0;
+	frame[1] = FRAME_SYNC1;
+	frame[2] = (u8)size;
+	frame[3] = (u8)(size >> 8);
+	memcpy(frame + 4, msg, size);
+	crc = crc16(frame + 2, size + 2);
+	frame[4 + size] = (u8)crc;
+	frame[5 + size] = (u8)(crc >> 8);
+	wifi_rx(frame, size + 6);
+}
+
+static void show(void) {
+	u32 leds = sim_gpio_output(XPAR_AXI_GPIO_0_DEVICE_ID);
+
+	printf("[sim] t=%.3fs state=%d leds=%c%c%c%c led4=%u led6=%u servo=%.2f%%\n",
+		(double)sim_now() / 1e9, get_state(),
+		(leds & 0x8) ? '1' : '0', (leds & 0x4) ? '1' : '0', (leds & 0x2) ? '1' : '0', (leds & 0x1) ? '1' : '0',
+		sim_gpiops_pin(LED4_PIN), sim_gpio_output(XPAR_AXI_GPIO_3_DEVICE_ID), sim_servo_duty());
+}
+
+void sim_command(const char *cmd) {
+	char line[1024];
+	u8 bytes[256];
+	u32 n = 0;
+	char *tok, *end;
+	int a = 0, b = 0, c = 0;
+	server_msg_t msg;
+
+	while (*cmd == ' ' || *cmd == '\t') cmd++;
+	snprintf(line, sizeof(line), "%s", cmd);
+	sscanf(line + 1, "%d %d %d", &a, &b, &c);
+	memset(&msg, 0, sizeof(msg));
+
+	switch (line[0]) {
+		case 'b':
+			buttons |= 1U << a;
+			sim_gpio_input(XPAR_AXI_GPIO_1_DEVICE_ID, buttons);
+			snprintf(line, sizeof(line), "r %d", a);
+			sim_schedule(sim_now() + BTN_HOLD, line);
+			break;
+		case 'r':
+			buttons &= ~(1U << a);
+			sim_gpio_input(XPAR_AXI_GPIO_1_DEVICE_ID, buttons);
+			break;
+		case 's':
+			for (tok = strtok(line + 1, " \t\n"); tok != NULL; tok = strtok(NULL, " \t\n"))
+				switches ^= 1U << (strtoul(tok, NULL, 10) & 0x1F);
+			sim_gpio_input(XPAR_AXI_GPIO_2_DEVICE_ID, switches);
+			break;
+		case 'p':
+			sim_adc_set(XADCPS_AUX14_OFFSET, (u16)(a * MAXADC / 100), (u16)(b * MAXADC / 100));
+			break;
+		case 'w':
+			for (tok = strtok(line + 1, " \t\n"); tok != NULL && n < sizeof(bytes); tok = strtok(NULL, " \t\n")) {
+				bytes[n] = (u8)strtoul(tok, &end, 16);
+				if (end != tok) n++;
+			}
+			wifi_rx(bytes, n);
+			break;
+		case 'u':
+			if (a < 0 || a >= 30) break;
+			msg.update.type = UPDATE;
+			msg.update.id = SERVER_ID;
+			msg.update.values[a] = b;
+			msg.update.average = b;
+			wifi_rx_framed(&msg, sizeof(update_response_t));
+			break;
+		case 'f':
+			msg.fetch.type = SUBSCRIBE;
+			msg.fetch.value = a;
+			msg.fetch.version = b;
+			wifi_rx_framed(&msg, sizeof(fetch_response_t));
+			break;
+		case 'n':
+			msg.notify.type = NOTIFY;
+			msg.notify.id = a;
+			msg.notify.value = b;
+			msg.notify.version = c;
+			wifi_rx_framed(&msg, sizeof(notify_t));
+			break;
+		case '?':
+			show();
+			break;
+		case 'q':
+			exit(EXIT_SUCCESS);
+		default:
+			break;
+	}
+}
@@ -0,0 +1,361 @@
+/*
+ * fsmcheck.c -- explore every state the FSM can reach & check invariants
+ *
+ * the firmware boots as usual; the first time its main loop goes idle,
+ * wfi() takes over and tries every input from there, each in a fork() of
+ * the whole simulated board, so the children start from exactly the same
+ * FSM, timers, gate & leds:
+ *    M_SW_HI, M_SW_LO, T_SW_HI, T_SW_LO, P_BTN    fsm.c's own callbacks
+ *    T_INT                     time runs on until the state timer expires
+ *    T_INT+x, x+T_INT          either order of T_INT & an input, queued
+ *                              together before fsm_run gets to them
+ *    BLUE, POT                 time runs on to that maintenance timer
+ *    GATE                      time runs on until the gate gets there
+ * A child that comes back to the main loop in a state nobody has seen does
+ * the same from there. A state is what the FSM shows the world: its state,
+ * which of its timers are running, led6, the ped light, where the gate is
+ * headed & whether it got there.
+ *
+ * Every state reached is checked against the invariants below, and every
+ * change_state (seen through trace(), wrapped at link time) counts towards
+ * the coverage of (state, transition) with the state timer running or not.
+ * Violations are printed with the inputs that lead there; the exit status
+ * is 1 if there were any.
+ *
+ * Build & run from final/:
+ *    gcc -O2 -I. -I../sim/include -Wl,--wrap=trace -o ../fsmcheck *.c ../sim/hal.c ../sim/fsmcheck.c && ../fsmcheck
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "xparameters.h"
+#include "xadcps.h"
+#include "xil_exception.h"
+#include "xpseudo_asm.h"
+#include "fsm_spec.h"
+#include "fsm_table.h"
+#include "trace.h"
+
+#define NS_PER_SEC 		1000000000ULL
+#define MAX_WAIT 		(60 * NS_PER_SEC)	/* longest a timer or the gate is waited for */
+#define MAX_PATH 		256
+#define MAX_REPORTS 	20					/* violations printed, the rest are only counted */
+#define POT_RAW 		31350				/* pot at half way, c.f. MAXADC in adc.c */
+
+#define GATE_OTHER 		2					/* gate headed neither OPEN nor CLOSED */
+#define NUM_KEYS 		(FSM_NUM_STATES << 10)
+
+#define NAME(x) #x,
+static const char *stateNames[] = { FSM_STATES(NAME) };
+static const char *transNames[] = { FSM_TRANSITIONS(NAME) };
+
+// inputs, in the order they are tried
+enum {
+	EV_M_SW_HI, EV_M_SW_LO, EV_T_SW_HI, EV_T_SW_LO, EV_P_BTN,	/* same values as the transitions */
+	EV_T_INT,
+	EV_T_INT_FIRST,												/* + one of the five above */
+	EV_T_INT_LAST = EV_T_INT_FIRST + 5,							/* + one of the five above */
+	EV_BLUE = EV_T_INT_LAST + 5,
+	EV_POT,
+	EV_GATE,
+	NUM_EVENTS
+};
+
+typedef struct {
+	u8 visited[NUM_KEYS];
+	u32 cover[FSM_NUM_STATES][FSM_NUM_TRANS][2];	/* change_states, by whether the state timer ran */
+	u32 states, edges, violations;
+} shared_t;
+
+static shared_t *shared;				/* seen by every process */
+static FILE *out;						/* stdout; the firmware's own is silenced */
+static u8 path[MAX_PATH];				/* inputs from boot to here */
+static u32 depth = 0;
+static bool started = false;
+static bool timerRan = false;			/* the state timer was running when the input came */
+static u32 expired = 0;					/* fsm timers that expired, a bit each */
+static int lastNext = -1;				/* previous change_state's next state */
+
+/****************************** OBSERVING *****************************/
+
+static u32 gate_class(void) {
+	u32 t = gate_target();
+	return (t == OPEN) ? 1 : (t == CLOSED) ? 0 : GATE_OTHER;
+}
+
+static u32 led6(void) {
+	return sim_gpio_output(XPAR_AXI_GPIO_3_DEVICE_ID) & W;
+}
+
+static bool ped(void) {
+	return sim_gpiops_pin(MIO7) != 0;
+}
+
+static u32 key(void) {
+	u32 k = (u32)get_state();
+
+	k = (k << 1) | ttc_timer_armed(TIMER_STATE);
+	k = (k << 1) | ttc_timer_armed(TIMER_BLUE);
+	k = (k << 1) | ttc_timer_armed(TIMER_POT);
+	k = (k << 3) | led6();
+	k = (k << 1) | ped();
+	k = (k << 2) | gate_class();
+	return (k << 1) | gate_arrived();
+}
+
+static void print_path(void) {
+	static const char *events[] = { "M_SW_HI", "M_SW_LO", "T_SW_HI", "T_SW_LO", "P_BTN" };
+
+	fprintf(out, "    boot");
+	for (u32 i = 0; i < depth; i++) {
+		u8 e = path[i];
+		if (e < EV_T_INT) fprintf(out, ", %s", events[e]);
+		else if (e == EV_T_INT) fprintf(out, ", T_INT");
+		else if (e < EV_T_INT_LAST) fprintf(out, ", T_INT+%s", events[e - EV_T_INT_FIRST]);
+		else if (e < EV_BLUE) fprintf(out, ", %s+T_INT", events[e - EV_T_INT_LAST]);
+		else fprintf(out, ", %s", (e == EV_BLUE) ? "BLUE" : (e == EV_POT) ? "POT" : "GATE");
+	}
+	fprintf(out, "\n");
+}
+
+static void violation(const char *what) {
+	u32 n = __atomic_fetch_add(&shared->violations, 1, __ATOMIC_RELAXED);
+
+	if (n >= MAX_REPORTS) return;
+	fprintf(out, "VIOLATION in %s (led6 %u, ped %s, gate %u headed %u): %s\n",
+		stateNames[get_state()], led6(), ped() ? "on" : "off", gate_position(), gate_target(), what);
+	print_path();
+}
+
+/*
+ * the invariants, checked once for every state reached
+ */
+static void check(void) {
+	int s = get_state();
+	bool m = (s == MAINTENANCE || s == M_TRAIN || s == M_CLR);
+	u32 light = led6();
+
+	// safety
+	if (s == TRAIN && gate_target() != CLOSED) violation("gate not closing while TRAIN");
+	if (s == TRAIN && gate_arrived() && gate_position() != CLOSED) violation("gate open while TRAIN");
+	if (light == G && ped()) violation("green while the ped light is on");
+	if (light == G && gate_target() != OPEN) violation("green with the gate not open");
+	if (light == G && (s == Y_TRAIN || s == TRAIN || s == PED_TRAIN)) violation("green while a train is about");
+	if (m && light != B && light != OFF) violation("traffic light on in maintenance");
+
+	// M_CLR is only ever passed through, on DEFAULT
+	if (s == M_CLR) violation("resting in M_CLR");
+
+	// liveness: every state that doesn't wait on an input has its way out running
+	if (!m && s != V_OK && s != TRAIN && !ttc_timer_armed(TIMER_STATE)) violation("no state timer, stuck");
+	if ((s == MAINTENANCE || s == M_TRAIN) && !ttc_timer_armed(TIMER_BLUE)) violation("blue light not blinking");
+	if (!m && (ttc_timer_armed(TIMER_BLUE) || ttc_timer_armed(TIMER_POT))) violation("maintenance timers left running");
+}
+
+/*
+ * fsm.c traces every change_state, after the transition's action & before
+ * the outputs; M_CLR moving straight on is a change_state within one
+ */
+void __wrap_trace(u16 id, s16 a0, s16 a1, s16 a2) {
+	if (id != TR_STATE || !started) return;
+	if (a0 < 0 || a0 >= FSM_NUM_STATES || a2 < 0 || a2 >= FSM_NUM_TRANS) {
+		violation("change_state out of range");
+		return;
+	}
+	if (lastNext == M_CLR && !(a0 == M_CLR && a2 == DEFAULT)) violation("M_CLR didn't move straight on");
+	if (a1 != (fsmTable[a0][a2] & FSM_NEXT_MASK)) violation("change_state disagrees with fsm_table.h");
+	lastNext = a1;
+	__atomic_fetch_add(&shared->cover[a0][a2][timerRan], 1, __ATOMIC_RELAXED);
+}
+
+/****************************** DRIVING *****************************/
+
+static void expiry(u32 timer) {
+	expired |= 1U << timer;
+	ttc_callback(timer);
+}
+
+/*
+ * let simulated time run, interrupts on, until done() or MAX_WAIT; false
+ * if it never happened
+ */
+static bool run_until(bool (*done)(void)) {
+	u64 end = sim_now() + MAX_WAIT;
+	u32 cpsr = mfcpsr();
+	bool ok;
+
+	Xil_ExceptionEnable();
+	while (!(ok = done()) && sim_now() < end) {
+		u64 next = sim_ttc_next();
+		sim_advance((next > 0 && sim_now() + next < end) ? next : end - sim_now());
+	}
+	mtcpsr(cpsr);
+	return ok;
+}
+
+static bool state_expired(void) { return (expired & (1U << TIMER_STATE)) != 0; }
+static bool blue_expired(void) { return (expired & (1U << TIMER_BLUE)) != 0; }
+static bool pot_expired(void) { return (expired & (1U << TIMER_POT)) != 0; }
+
+static void input(u32 e) {
+	io_edge_t edge = { 0, true, 0 };
+
+	switch (e) {
+		case EV_M_SW_HI: edge.pin = 0; edge.hi = true; sw_callback(&edge); break;
+		case EV_M_SW_LO: edge.pin = 0; edge.hi = false; sw_callback(&edge); break;
+		case EV_T_SW_HI: edge.pin = 1; edge.hi = true; sw_callback(&edge); break;
+		case EV_T_SW_LO: edge.pin = 1; edge.hi = false; sw_callback(&edge); break;
+		case EV_P_BTN: edge.pin = 0; btn_callback(&edge); break;
+		default: break;
+	}
+}
+
+/*
+ * whether e can happen from here
+ */
+static bool possible(u32 e) {
+	if (e >= EV_T_INT && e < EV_BLUE) return ttc_timer_armed(TIMER_STATE);
+	if (e == EV_BLUE) return ttc_timer_armed(TIMER_BLUE);
+	if (e == EV_POT) return ttc_timer_armed(TIMER_POT);
+	if (e == EV_GATE) return !gate_arrived();
+	return true;
+}
+
+/*
+ * put e on the board; the main loop runs what it queued once we return
+ */
+static void apply(u32 e) {
+	expired = 0;
+	timerRan = ttc_timer_armed(TIMER_STATE);
+
+	if (e < EV_T_INT) input(e);
+	else if (e == EV_T_INT) run_until(&state_expired);
+	else if (e < EV_T_INT_LAST) {
+		run_until(&state_expired);
+		input(e - EV_T_INT_FIRST);
+	}
+	else if (e < EV_BLUE) {
+		input(e - EV_T_INT_LAST);
+		run_until(&state_expired);
+	}
+	else if (e == EV_BLUE) run_until(&blue_expired);
+	else if (e == EV_POT) run_until(&pot_expired);
+	else if (e == EV_GATE) run_until(&gate_arrived);
+}
+
+/****************************** EXPLORING *****************************/
+
+static void report(double wall) {
+	u32 s, t, hit = 0, both = 0;
+
+	fprintf(out, "%u states, %u inputs tried, %.3fs\n\n", shared->states, shared->edges, wall);
+	fprintf(out, "change_state coverage (t: with the state timer running, -: without, b: both)\n");
+	fprintf(out, "%-12s", "");
+	for (t = 0; t < FSM_NUM_TRANS; t++) fprintf(out, " %-8s", transNames[t]);
+	fprintf(out, "\n");
+	for (s = 0; s < FSM_NUM_STATES; s++) {
+		fprintf(out, "%-12s", stateNames[s]);
+		for (t = 0; t < FSM_NUM_TRANS; t++) {
+			bool ran = shared->cover[s][t][1] > 0, idle = shared->cover[s][t][0] > 0;
+			fprintf(out, " %-8s", (ran && idle) ? "b" : ran ? "t" : idle ? "-" : ".");
+			hit += ran || idle;
+			both += ran && idle;
+		}
+		fprintf(out, "\n");
+	}
+	fprintf(out, "\n%u of %u (state, transition) covered, %u both ways; %u violations\n",
+		hit, FSM_NUM_STATES * FSM_NUM_TRANS, both, shared->violations);
+}
+
+static double wall_s(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * the main loop has nothing left to do: a new state to explore from, or
+ * one we've seen
+ */
+static void explore_wfi(void) {
+	static double wallStart;
+	bool root = !started;
+	u32 k, e;
+	int status;
+	pid_t pid;
+
+	if (root) {
+		started = true;
+		wallStart = wall_s();
+		ttc_timer_callback(TIMER_STATE, &expiry);
+		ttc_timer_callback(TIMER_BLUE, &expiry);
+		ttc_timer_callback(TIMER_POT, &expiry);
+	}
+	k = key();
+	if (__atomic_exchange_n(&shared->visited[k], 1, __ATOMIC_RELAXED)) _exit(EXIT_SUCCESS);
+	shared->states++;
+	check();
+
+	for (e = 0; e < NUM_EVENTS; e++) {
+		if (!possible(e) || depth == MAX_PATH) continue;
+		shared->edges++;
+		fflush(NULL);
+		if ((pid = fork()) < 0) {
+			perror("fork");
+			exit(EXIT_FAILURE);
+		}
+		if (pid == 0) {
+			path[depth++] = (u8)e;
+			lastNext = -1;
+			apply(e);
+			return;
+		}
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)) {
+			path[depth] = (u8)e;
+			depth++;
+			violation("the firmware crashed");
+			depth--;
+		}
+	}
+
+	if (!root) _exit(EXIT_SUCCESS);
+	report(wall_s() - wallStart);
+	fflush(out);
+	_exit(shared->violations ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*
+ * the firmware's sleep() passes simulated time
+ */
+unsigned int sleep(unsigned int seconds) {
+	sim_advance((u64)seconds * NS_PER_SEC);
+	return 0;
+}
+
+__attribute__((constructor))
+static void fsmcheck_init(void) {
+	shared = mmap(NULL, sizeof(shared_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		perror("mmap");
+		exit(EXIT_FAILURE);
+	}
+
+	// the report goes to stdout, the firmware's chatter nowhere
+	out = fdopen(dup(STDOUT_FILENO), "w");
+	if (out == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+		perror("fsmcheck");
+		exit(EXIT_FAILURE);
+	}
+	setvbuf(out, NULL, _IONBF, 0);
+
+	sim_adc_set(XADCPS_AUX14_OFFSET, POT_RAW, 0);
+	sim_set_wfi(&explore_wfi);
+}
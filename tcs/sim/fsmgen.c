@@ -0,0 +1,95 @@
+/*
+ * fsmgen.c -- generate final/fsm_table.h from final/fsm_spec.h
+ *
+ * applies the spec's rules in order to fill in every (state, transition)
+ * cell, then prints the result as a const array fsm.c indexes directly.
+ * Build & run from final/ (c.f. fsm_spec.h):
+ *    gcc -I. -I../sim/include -o fsmgen ../sim/fsmgen.c && ./fsmgen > fsm_table.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fsm_spec.h"
+
+#define NAME(x) #x,
+#define VALUE(x) x,
+
+static const char *stateNames[] = { FSM_STATES(NAME) };
+static const char *transNames[] = { FSM_TRANSITIONS(NAME) };
+static const int stateValues[] = { FSM_STATES(VALUE) };
+static const int transValues[] = { FSM_TRANSITIONS(VALUE) };
+
+#define NUM_STATES (int)(sizeof(stateNames) / sizeof(stateNames[0]))
+#define NUM_TRANS  (int)(sizeof(transNames) / sizeof(transNames[0]))
+
+static int next[NUM_STATES][NUM_TRANS];
+static int act[NUM_STATES][NUM_TRANS];
+
+static void rule(unsigned from, unsigned on, int to) {
+	if (to < 0 || to >= NUM_STATES) {
+		fprintf(stderr, "fsmgen: rule to unknown state %d\n", to);
+		exit(EXIT_FAILURE);
+	}
+	for (int s = 0; s < NUM_STATES; s++)
+		for (int t = 0; t < NUM_TRANS; t++)
+			if ((from & S(s)) && (on & T(t))) next[s][t] = to;
+}
+
+static void action(unsigned from, unsigned on) {
+	for (int s = 0; s < NUM_STATES; s++)
+		for (int t = 0; t < NUM_TRANS; t++)
+			if ((from & S(s)) && (on & T(t))) act[s][t] = 1;
+}
+
+#define APPLY_RULE(from, on, to) rule(from, on, to);
+#define APPLY_ACTION(from, on) action(from, on);
+
+int main(void) {
+	int s, t;
+
+	// the table is indexed by value, so the lists must be in value order
+	for (s = 0; s < NUM_STATES; s++)
+		if (stateValues[s] != s) {
+			fprintf(stderr, "fsmgen: %s is %d, expected %d\n", stateNames[s], stateValues[s], s);
+			return EXIT_FAILURE;
+		}
+	for (t = 0; t < NUM_TRANS; t++)
+		if (transValues[t] != t) {
+			fprintf(stderr, "fsmgen: %s is %d, expected %d\n", transNames[t], transValues[t], t);
+			return EXIT_FAILURE;
+		}
+
+	// no rule means no change of state
+	for (s = 0; s < NUM_STATES; s++)
+		for (t = 0; t < NUM_TRANS; t++)
+			next[s][t] = s;
+
+	FSM_RULES(APPLY_RULE)
+	FSM_ACTIONS(APPLY_ACTION)
+
+	printf("/*\n");
+	printf(" * fsm_table.h -- generated by sim/fsmgen.c from fsm_spec.h, do not edit\n");
+	printf(" *\n");
+	printf(" * fsmTable[state][transition] is the next state, or'd with FSM_ACT if the\n");
+	printf(" * transition's action runs (c.f. fsm_spec.h)\n");
+	printf(" */\n");
+	printf("#pragma once\n\n");
+	printf("#define FSM_NUM_STATES %d\n", NUM_STATES);
+	printf("#define FSM_NUM_TRANS  %d\n", NUM_TRANS);
+	printf("#define FSM_NEXT_MASK  0x0F\n");
+	printf("#define FSM_ACT        0x10\n\n");
+
+	printf("static const u8 fsmTable[FSM_NUM_STATES][FSM_NUM_TRANS] = {\n");
+	printf("\t/* %-12s      ", "");
+	for (t = 0; t < NUM_TRANS; t++) printf("%-10s", transNames[t]);
+	printf("*/\n");
+	for (s = 0; s < NUM_STATES; s++) {
+		printf("\t/* %-12s */ {", stateNames[s]);
+		for (t = 0; t < NUM_TRANS; t++)
+			printf(" 0x%02X%s", next[s][t] | (act[s][t] ? 0x10 : 0), (t < NUM_TRANS - 1) ? ",    " : " ");
+		printf("},\n");
+	}
+	printf("};\n");
+	return 0;
+}
@@ -0,0 +1,888 @@
+/*
+ * hal.c -- simulated Xilinx drivers and virtual GIC for the host build
+ *
+ * every interrupt source is modelled as a level: the GIC delivers an id
+ * while its device asserts it (or it was raised by sim_irq), the cpu irq
+ * mask is clear, and a handler is connected and enabled; handlers clear
+ * the level through the same driver calls they make on the board
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "xparameters.h"
+#include "xil_exception.h"
+#include "xpseudo_asm.h"
+#include "xscugic.h"
+#include "xgpio.h"
+#include "xgpiops.h"
+#include "xuartps.h"
+#include "xttcps.h"
+#include "xadcps.h"
+#include "xtmrctr.h"
+#include "xtime_l.h"
+#include "xreg_cortexa9.h"
+#include "platform.h"
+#include "rec.h"
+
+#define NUM_INTR 		XSCUGIC_MAX_NUM_INTR_INPUTS
+#define NUM_GPIO 		4
+#define NUM_UART 		2
+#define DELIVER_LIMIT 	100000		/* back to back interrupts before we call it a storm */
+
+/****************************** CPU & GIC *****************************/
+
+static bool irqMasked = true;					/* cpu comes out of reset with irqs masked */
+static Xil_ExceptionHandler irqHandler = NULL;	/* what Xil_ExceptionRegisterHandler installed */
+static void *irqData = NULL;
+
+static struct {
+	Xil_InterruptHandler handler;
+	void *ref;
+	bool enabled;
+	bool raised;						/* by sim_irq, cleared on delivery */
+} gicTable[NUM_INTR];
+
+static u32 activeId;					/* id being delivered, read by XScuGic_InterruptHandler */
+static bool delivering = false;
+
+static bool line_asserted(u32 id);
+static void uart_flush_tx(void);
+
+static u64 now = 0;						/* simulated time, ns */
+static void (*wfiHook)(void) = NULL;
+
+/*
+ * deliver every asserted, enabled interrupt, as long as the cpu lets us
+ */
+static void deliver(void) {
+	int storm = 0;
+
+	if (delivering) return;
+	delivering = true;
+
+	while (!irqMasked && irqHandler != NULL) {
+		u32 id;
+
+		uart_flush_tx();			/* time passes between interrupts, the tx FIFO empties */
+		for (id = 0; id < NUM_INTR; id++)
+			if (gicTable[id].enabled && gicTable[id].handler != NULL && (gicTable[id].raised || line_asserted(id)))
+				break;
+		if (id == NUM_INTR) break;
+
+		if (++storm > DELIVER_LIMIT) {
+			fprintf(stderr, "[sim] interrupt %u never clears\n", id);
+			exit(EXIT_FAILURE);
+		}
+
+		// take the exception: irqs masked until the handler returns
+		gicTable[id].raised = false;
+		activeId = id;
+		irqMasked = true;
+		irqHandler(irqData);
+		irqMasked = false;
+	}
+
+	delivering = false;
+}
+
+void Xil_ExceptionRegisterHandler(u32 Exception_id, Xil_ExceptionHandler Handler, void *Data) {
+	if (Exception_id == XIL_EXCEPTION_ID_INT) {
+		irqHandler = Handler;
+		irqData = Data;
+	}
+}
+
+void Xil_ExceptionRemoveHandler(u32 Exception_id) {
+	if (Exception_id == XIL_EXCEPTION_ID_INT) {
+		irqHandler = NULL;
+		irqData = NULL;
+	}
+}
+
+void Xil_ExceptionEnable(void) {
+	irqMasked = false;
+	deliver();
+}
+
+void Xil_ExceptionDisable(void) {
+	irqMasked = true;
+}
+
+u32 sim_mfcpsr(void) {
+	return irqMasked ? XIL_EXCEPTION_IRQ : 0;
+}
+
+void sim_mtcpsr(u32 cpsr) {
+	irqMasked = (cpsr & XIL_EXCEPTION_IRQ) != 0;
+	deliver();
+}
+
+void sim_wfi(void) {
+	if (wfiHook != NULL) wfiHook();
+}
+
+static u32 pmcr = 0;
+static u32 pmcnten = 0;
+
+u32 sim_mfcp(u32 reg) {
+	struct timespec ts;
+
+	switch (reg) {
+		case XREG_CP15_PERF_MONITOR_CTRL:
+			return pmcr;
+		case XREG_CP15_COUNT_ENABLE_SET:
+			return pmcnten;
+		case XREG_CP15_PERF_CYCLE_COUNTER:
+			// handlers take no simulated time, so time them on the host
+			if (!(pmcr & 0x1) || !(pmcnten & 0x80000000U)) return 0;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (u32)(((u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec) * (XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 1000000) / 1000);
+		default:
+			return 0;
+	}
+}
+
+void sim_mtcp(u32 reg, u32 value) {
+	if (reg == XREG_CP15_PERF_MONITOR_CTRL) pmcr = value;
+	else if (reg == XREG_CP15_COUNT_ENABLE_SET) pmcnten |= value;
+}
+
+void sim_set_wfi(void (*hook)(void)) {
+	wfiHook = hook;
+}
+
+void sim_irq(u32 id) {
+	if (id < NUM_INTR) gicTable[id].raised = true;
+	deliver();
+}
+
+static XScuGic_Config gicConfig = { XPAR_PS7_SCUGIC_0_DEVICE_ID, XPAR_PS7_SCUGIC_0_BASEADDR, 0 };
+
+XScuGic_Config *XScuGic_LookupConfig(u16 DeviceId) {
+	return (DeviceId == gicConfig.DeviceId) ? &gicConfig : NULL;
+}
+
+s32 XScuGic_CfgInitialize(XScuGic *InstancePtr, XScuGic_Config *ConfigPtr, u32 EffectiveAddr) {
+	if (InstancePtr == NULL || ConfigPtr == NULL) return XST_FAILURE;
+	InstancePtr->Config = ConfigPtr;
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	return XST_SUCCESS;
+}
+
+s32 XScuGic_Connect(XScuGic *InstancePtr, u32 Int_Id, Xil_InterruptHandler Handler, void *CallBackRef) {
+	if (Int_Id >= NUM_INTR || Handler == NULL) return XST_FAILURE;
+	gicTable[Int_Id].handler = Handler;
+	gicTable[Int_Id].ref = CallBackRef;
+	return XST_SUCCESS;
+}
+
+void XScuGic_Disconnect(XScuGic *InstancePtr, u32 Int_Id) {
+	if (Int_Id < NUM_INTR) {
+		gicTable[Int_Id].handler = NULL;
+		gicTable[Int_Id].ref = NULL;
+	}
+}
+
+void XScuGic_Enable(XScuGic *InstancePtr, u32 Int_Id) {
+	if (Int_Id < NUM_INTR) gicTable[Int_Id].enabled = true;
+	deliver();
+}
+
+void XScuGic_Disable(XScuGic *InstancePtr, u32 Int_Id) {
+	if (Int_Id < NUM_INTR) gicTable[Int_Id].enabled = false;
+}
+
+void XScuGic_Stop(XScuGic *InstancePtr) {
+	for (u32 id = 0; id < NUM_INTR; id++) gicTable[id].enabled = false;
+	InstancePtr->IsReady = 0;
+}
+
+u32 XScuGic_CPUReadReg(XScuGic *InstancePtr, u32 RegOffset) {
+	if (RegOffset != XSCUGIC_HI_PEND_OFFSET) return 0;
+	for (u32 id = 0; id < NUM_INTR; id++)
+		if (gicTable[id].enabled && gicTable[id].handler != NULL && (gicTable[id].raised || line_asserted(id)))
+			return id;
+	return 1023;		/* spurious, nothing pending */
+}
+
+void XScuGic_InterruptHandler(XScuGic *InstancePtr) {
+	if (activeId < NUM_INTR && gicTable[activeId].handler != NULL)
+		gicTable[activeId].handler(gicTable[activeId].ref);
+}
+
+/****************************** AXI GPIO *****************************/
+
+static struct {
+	u32 in;							/* levels on the pins */
+	u32 out;						/* data register */
+	u32 tri;						/* 1 bits are inputs */
+	u32 ier;
+	bool gie;
+	u32 isr;
+} gpio[NUM_GPIO];
+
+static const u32 gpioIntr[NUM_GPIO] = { NUM_INTR, XPAR_FABRIC_GPIO_1_VEC_ID, XPAR_FABRIC_GPIO_2_VEC_ID, NUM_INTR };
+
+int XGpio_Initialize(XGpio *InstancePtr, u16 DeviceId) {
+	if (DeviceId >= NUM_GPIO) return XST_FAILURE;
+	InstancePtr->DeviceId = DeviceId;
+	InstancePtr->BaseAddress = XPAR_AXI_GPIO_0_BASEADDR + 0x10000 * DeviceId;
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	return XST_SUCCESS;
+}
+
+void XGpio_SetDataDirection(XGpio *InstancePtr, unsigned Channel, u32 DirectionMask) {
+	gpio[InstancePtr->DeviceId].tri = DirectionMask;
+}
+
+u32 XGpio_DiscreteRead(XGpio *InstancePtr, unsigned Channel) {
+	u16 dev = InstancePtr->DeviceId;
+
+	// the button & switch IP is built all-inputs, so the direction register doesn't mask them
+	return gpio[dev].in | (gpio[dev].out & ~gpio[dev].tri);
+}
+
+void XGpio_DiscreteWrite(XGpio *InstancePtr, unsigned Channel, u32 Mask) {
+	gpio[InstancePtr->DeviceId].out = Mask;
+}
+
+void XGpio_InterruptGlobalEnable(XGpio *InstancePtr) {
+	gpio[InstancePtr->DeviceId].gie = true;
+	deliver();
+}
+
+void XGpio_InterruptGlobalDisable(XGpio *InstancePtr) {
+	gpio[InstancePtr->DeviceId].gie = false;
+}
+
+void XGpio_InterruptEnable(XGpio *InstancePtr, u32 Mask) {
+	gpio[InstancePtr->DeviceId].ier |= Mask;
+	deliver();
+}
+
+void XGpio_InterruptDisable(XGpio *InstancePtr, u32 Mask) {
+	gpio[InstancePtr->DeviceId].ier &= ~Mask;
+}
+
+void XGpio_InterruptClear(XGpio *InstancePtr, u32 Mask) {
+	gpio[InstancePtr->DeviceId].isr &= ~Mask;
+}
+
+u32 XGpio_InterruptGetStatus(XGpio *InstancePtr) {
+	return gpio[InstancePtr->DeviceId].isr;
+}
+
+void sim_gpio_input(u16 deviceId, u32 value) {
+	if (deviceId >= NUM_GPIO || gpio[deviceId].in == value) return;
+	gpio[deviceId].in = value;
+	gpio[deviceId].isr |= XGPIO_IR_CH1_MASK;	/* any input change */
+	deliver();
+}
+
+u32 sim_gpio_output(u16 deviceId) {
+	return (deviceId < NUM_GPIO) ? gpio[deviceId].out : 0;
+}
+
+static bool gpio_line(u16 dev) {
+	return gpio[dev].gie && (gpio[dev].isr & gpio[dev].ier) != 0;
+}
+
+/****************************** PS GPIO *****************************/
+
+static XGpioPs_Config gpioPsConfig = { XPAR_PS7_GPIO_0_DEVICE_ID, XPAR_PS7_GPIO_0_BASEADDR };
+static u32 gpioPsPins[XGPIOPS_MAX_PINS];
+
+XGpioPs_Config *XGpioPs_LookupConfig(u16 DeviceId) {
+	return (DeviceId == gpioPsConfig.DeviceId) ? &gpioPsConfig : NULL;
+}
+
+s32 XGpioPs_CfgInitialize(XGpioPs *InstancePtr, const XGpioPs_Config *ConfigPtr, u32 EffectiveAddr) {
+	if (InstancePtr == NULL || ConfigPtr == NULL) return XST_FAILURE;
+	InstancePtr->GpioConfig = *ConfigPtr;
+	InstancePtr->GpioConfig.BaseAddr = EffectiveAddr;
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	return XST_SUCCESS;
+}
+
+void XGpioPs_SetDirectionPin(XGpioPs *InstancePtr, u32 Pin, u32 Direction) {}
+
+void XGpioPs_SetOutputEnablePin(XGpioPs *InstancePtr, u32 Pin, u32 OpEnable) {}
+
+void XGpioPs_WritePin(XGpioPs *InstancePtr, u32 Pin, u32 Data) {
+	if (Pin < XGPIOPS_MAX_PINS) gpioPsPins[Pin] = Data & 0x1;
+}
+
+u32 XGpioPs_ReadPin(XGpioPs *InstancePtr, u32 Pin) {
+	return (Pin < XGPIOPS_MAX_PINS) ? gpioPsPins[Pin] : 0;
+}
+
+u32 sim_gpiops_pin(u32 pin) {
+	return (pin < XGPIOPS_MAX_PINS) ? gpioPsPins[pin] : 0;
+}
+
+/****************************** PS UART *****************************/
+
+static XUartPs_Config uartConfig[NUM_UART] = {
+	{ XPAR_PS7_UART_0_DEVICE_ID, XPAR_PS7_UART_0_BASEADDR, 100000000 },
+	{ XPAR_PS7_UART_1_DEVICE_ID, XPAR_PS7_UART_1_BASEADDR, 100000000 },
+};
+
+static const u32 uartIntr[NUM_UART] = { XPAR_XUARTPS_0_INTR, XPAR_XUARTPS_1_INTR };
+
+static void tty_putc(u8 byte) {
+	putchar(byte);
+}
+
+static struct {
+	u8 rx[XUARTPS_FIFO_SIZE];
+	u32 rxHead;						/* oldest byte */
+	u32 rxCount;
+	u32 txCount;					/* bytes in the tx FIFO not yet on the line */
+	u8 tx[XUARTPS_FIFO_SIZE];
+	u32 imr;
+	u32 tout;						/* receive timeout latched, cleared through ISR */
+	u8 threshold;
+	u8 timeout;
+	void (*txHook)(u8 byte);
+} uart[NUM_UART] = {
+	{ .threshold = 32, .txHook = NULL },
+	{ .threshold = 32, .txHook = tty_putc },
+};
+
+static int uart_index(u32 base) {
+	for (int i = 0; i < NUM_UART; i++)
+		if (uartConfig[i].BaseAddress == base) return i;
+	return -1;
+}
+
+static u32 uart_isr(int u) {
+	u32 isr = uart[u].tout;
+	if (uart[u].threshold > 0 && uart[u].rxCount >= uart[u].threshold) isr |= XUARTPS_IXR_RXOVR;
+	if (uart[u].rxCount == 0) isr |= XUARTPS_IXR_RXEMPTY;
+	if (uart[u].rxCount == XUARTPS_FIFO_SIZE) isr |= XUARTPS_IXR_RXFULL;
+	if (uart[u].txCount == 0) isr |= XUARTPS_IXR_TXEMPTY;
+	if (uart[u].txCount == XUARTPS_FIFO_SIZE) isr |= XUARTPS_IXR_TXFULL;
+	return isr;
+}
+
+static void uart_flush_tx(void) {
+	for (int u = 0; u < NUM_UART; u++) {
+		for (u32 i = 0; i < uart[u].txCount; i++)
+			if (uart[u].txHook != NULL) uart[u].txHook(uart[u].tx[i]);
+		uart[u].txCount = 0;
+	}
+}
+
+u32 XUartPs_ReadReg(u32 BaseAddress, u32 RegOffset) {
+	int u = uart_index(BaseAddress);
+	u32 val = 0;
+
+	if (u < 0) return 0;
+	switch (RegOffset) {
+		case XUARTPS_FIFO_OFFSET:
+			if (uart[u].rxCount > 0) {
+				val = uart[u].rx[uart[u].rxHead];
+				uart[u].rxHead = (uart[u].rxHead + 1) % XUARTPS_FIFO_SIZE;
+				uart[u].rxCount--;
+			}
+			break;
+		case XUARTPS_SR_OFFSET:
+			if (uart[u].rxCount == 0) val |= XUARTPS_SR_RXEMPTY;
+			if (uart[u].txCount == XUARTPS_FIFO_SIZE) val |= XUARTPS_SR_TXFULL;
+			break;
+		case XUARTPS_IMR_OFFSET:
+			val = uart[u].imr;
+			break;
+		case XUARTPS_ISR_OFFSET:
+			val = uart_isr(u);
+			break;
+		default:
+			break;
+	}
+	return val;
+}
+
+void XUartPs_WriteReg(u32 BaseAddress, u32 RegOffset, u32 RegisterValue) {
+	int u = uart_index(BaseAddress);
+
+	if (u < 0) return;
+	switch (RegOffset) {
+		case XUARTPS_FIFO_OFFSET:
+			if (uart[u].txCount < XUARTPS_FIFO_SIZE) uart[u].tx[uart[u].txCount++] = (u8)RegisterValue;
+			break;
+		case XUARTPS_IER_OFFSET:
+			uart[u].imr |= RegisterValue;
+			deliver();
+			break;
+		case XUARTPS_IDR_OFFSET:
+			uart[u].imr &= ~RegisterValue;
+			break;
+		case XUARTPS_ISR_OFFSET:
+			uart[u].tout &= ~RegisterValue;		/* the level bits clear themselves */
+			break;
+		default:
+			break;
+	}
+}
+
+XUartPs_Config *XUartPs_LookupConfig(u16 DeviceId) {
+	return (DeviceId < NUM_UART) ? &uartConfig[DeviceId] : NULL;
+}
+
+s32 XUartPs_CfgInitialize(XUartPs *InstancePtr, XUartPs_Config *Config, u32 EffectiveAddr) {
+	if (InstancePtr == NULL || Config == NULL) return XST_FAILURE;
+	InstancePtr->Config = *Config;
+	InstancePtr->Config.BaseAddress = EffectiveAddr;
+	InstancePtr->BaudRate = XUARTPS_DFT_BAUDRATE;
+	InstancePtr->Handler = NULL;
+	InstancePtr->CallBackRef = NULL;
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	return XST_SUCCESS;
+}
+
+void XUartPs_DisableUart(XUartPs *InstancePtr) {}
+
+void XUartPs_EnableUart(XUartPs *InstancePtr) {}
+
+s32 XUartPs_SetBaudRate(XUartPs *InstancePtr, u32 BaudRate) {
+	InstancePtr->BaudRate = BaudRate;
+	return XST_SUCCESS;
+}
+
+void XUartPs_SetFifoThreshold(XUartPs *InstancePtr, u8 TriggerLevel) {
+	int u = uart_index(InstancePtr->Config.BaseAddress);
+	if (u >= 0) uart[u].threshold = TriggerLevel;
+}
+
+void XUartPs_SetRecvTimeout(XUartPs *InstancePtr, u8 RecvTimeout) {
+	int u = uart_index(InstancePtr->Config.BaseAddress);
+	if (u >= 0) uart[u].timeout = RecvTimeout;
+}
+
+void XUartPs_SetInterruptMask(XUartPs *InstancePtr, u32 Mask) {
+	int u = uart_index(InstancePtr->Config.BaseAddress);
+	if (u >= 0) uart[u].imr = Mask;
+	deliver();
+}
+
+void XUartPs_SetHandler(XUartPs *InstancePtr, XUartPs_Handler FuncPtr, void *CallBackRef) {
+	InstancePtr->Handler = FuncPtr;
+	InstancePtr->CallBackRef = CallBackRef;
+}
+
+/*
+ * same event mapping as the real driver: rx threshold -> RECV_DATA, rx
+ * timeout -> RECV_TOUT, tx empty -> disarm TXEMPTY then SENT_DATA
+ */
+void XUartPs_InterruptHandler(XUartPs *InstancePtr) {
+	u32 base = InstancePtr->Config.BaseAddress;
+	int u = uart_index(base);
+	u32 isr;
+
+	if (u < 0) return;
+	isr = uart_isr(u) & uart[u].imr;
+
+	if ((isr & (XUARTPS_IXR_RXOVR | XUARTPS_IXR_RXFULL)) && InstancePtr->Handler != NULL)
+		InstancePtr->Handler(InstancePtr->CallBackRef, XUARTPS_EVENT_RECV_DATA, 0);
+	if ((isr & XUARTPS_IXR_TOUT) && InstancePtr->Handler != NULL)
+		InstancePtr->Handler(InstancePtr->CallBackRef, XUARTPS_EVENT_RECV_TOUT, 0);
+	if (isr & XUARTPS_IXR_TXEMPTY) {
+		XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, XUARTPS_IXR_TXEMPTY | XUARTPS_IXR_TXFULL);
+		if (InstancePtr->Handler != NULL)
+			InstancePtr->Handler(InstancePtr->CallBackRef, XUARTPS_EVENT_SENT_DATA, 0);
+	}
+
+	XUartPs_WriteReg(base, XUARTPS_ISR_OFFSET, isr);
+}
+
+u32 XUartPs_Send(XUartPs *InstancePtr, u8 *BufferPtr, u32 NumBytes) {
+	int u = uart_index(InstancePtr->Config.BaseAddress);
+
+	// the line is infinitely fast on the host
+	for (u32 i = 0; u >= 0 && i < NumBytes; i++)
+		if (uart[u].txHook != NULL) uart[u].txHook(BufferPtr[i]);
+	return NumBytes;
+}
+
+u32 XUartPs_Recv(XUartPs *InstancePtr, u8 *BufferPtr, u32 NumBytes) {
+	u32 base = InstancePtr->Config.BaseAddress;
+	u32 n = 0;
+
+	while (n < NumBytes && XUartPs_IsReceiveData(base))
+		BufferPtr[n++] = (u8)XUartPs_ReadReg(base, XUARTPS_FIFO_OFFSET);
+	return n;
+}
+
+static bool uart_line(int u) {
+	return (uart_isr(u) & uart[u].imr) != 0;
+}
+
+void sim_uart_rx(u16 deviceId, const u8 *buf, u32 len) {
+	if (deviceId >= NUM_UART) return;
+
+	for (u32 i = 0; i < len; i++) {
+		// a full FIFO drops the byte, as an overrun would
+		if (uart[deviceId].rxCount < XUARTPS_FIFO_SIZE) {
+			uart[deviceId].rx[(uart[deviceId].rxHead + uart[deviceId].rxCount) % XUARTPS_FIFO_SIZE] = buf[i];
+			uart[deviceId].rxCount++;
+		}
+		deliver();
+	}
+
+	// the line goes quiet after the burst
+	if (uart[deviceId].timeout > 0 && uart[deviceId].rxCount > 0)
+		uart[deviceId].tout = XUARTPS_IXR_TOUT;
+	deliver();
+}
+
+void sim_uart_tx_hook(u16 deviceId, void (*hook)(u8 byte)) {
+	if (deviceId < NUM_UART) uart[deviceId].txHook = hook;
+}
+
+/****************************** TTC *****************************/
+
+static XTtcPs_Config ttcConfig = { XPAR_XTTCPS_0_DEVICE_ID, XPAR_XTTCPS_0_BASEADDR, XPAR_XTTCPS_0_TTC_CLK_FREQ_HZ };
+static XTtcPs *ttc = NULL;				/* the instance the firmware initialized */
+static u64 ttcDeadline = 0;				/* time of the next interval interrupt */
+static u64 ttcStart = 0;				/* time the counter last read 0 */
+
+#define PS_DISABLE 16U					/* prescaler value meaning no prescaling */
+
+static u64 ttc_div(void) {
+	return (ttc->Prescaler >= PS_DISABLE) ? 1 : (1ULL << (ttc->Prescaler + 1));
+}
+
+static u64 ttc_period(void) {
+	return (u64)ttc->Interval * ttc_div() * 1000000000ULL / ttc->Config.InputClockHz;
+}
+
+/*
+ * counter ticks since ttcStart at time t, and the time tick k starts
+ */
+static u64 ttc_ticks(u64 t) {
+	return (u64)((unsigned __int128)(t - ttcStart) * ttc->Config.InputClockHz / (ttc_div() * 1000000000ULL));
+}
+
+static u64 ttc_tick_time(u64 k) {
+	u64 per = ttc_div() * 1000000000ULL;
+	return ttcStart + (u64)(((unsigned __int128)k * per + ttc->Config.InputClockHz - 1) / ttc->Config.InputClockHz);
+}
+
+/*
+ * time of the next interrupt the TTC raises, SIM_NEVER if none: the interval
+ * in interval mode, else the free-running counter reaching enabled match 0
+ */
+static u64 ttc_next_time(void) {
+	u64 cur, k;
+
+	if (ttc == NULL || !ttc->Running) return SIM_NEVER;
+	if (ttc->Options & XTTCPS_OPTION_INTERVAL_MODE) return ttcDeadline;
+	if (!(ttc->Options & XTTCPS_OPTION_MATCH_MODE) || !(ttc->IntrMask & XTTCPS_IXR_MATCH_0_MASK)) return SIM_NEVER;
+
+	cur = ttc_ticks(now);
+	k = (cur & ~0xFFFFULL) | ttc->Match[0];
+	if (k <= cur) k += 0x10000ULL;
+	return ttc_tick_time(k);
+}
+
+XTtcPs_Config *XTtcPs_LookupConfig(u16 DeviceId) {
+	return (DeviceId == ttcConfig.DeviceId) ? &ttcConfig : NULL;
+}
+
+s32 XTtcPs_CfgInitialize(XTtcPs *InstancePtr, XTtcPs_Config *ConfigPtr, u32 EffectiveAddr) {
+	if (InstancePtr == NULL || ConfigPtr == NULL) return XST_FAILURE;
+	memset(InstancePtr, 0, sizeof(XTtcPs));
+	InstancePtr->Config = *ConfigPtr;
+	InstancePtr->Config.BaseAddress = EffectiveAddr;
+	InstancePtr->Interval = XTTCPS_MAX_INTERVAL_COUNT;
+	InstancePtr->Prescaler = PS_DISABLE;
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	ttc = InstancePtr;
+	return XST_SUCCESS;
+}
+
+s32 XTtcPs_SetOptions(XTtcPs *InstancePtr, u32 Options) {
+	InstancePtr->Options = Options;
+	return XST_SUCCESS;
+}
+
+u32 XTtcPs_GetOptions(XTtcPs *InstancePtr) {
+	return InstancePtr->Options;
+}
+
+void XTtcPs_CalcIntervalFromFreq(XTtcPs *InstancePtr, u32 Freq, XInterval *Interval, u8 *Prescaler) {
+	u32 clk = InstancePtr->Config.InputClockHz;
+	u32 count;
+
+	*Interval = XTTCPS_MAX_INTERVAL_COUNT;
+	*Prescaler = 0xFF;
+	if (Freq == 0 || clk / Freq < 4) return;
+
+	count = clk / Freq;
+	if (count < 65536U) {
+		*Interval = (XInterval)count;
+		*Prescaler = PS_DISABLE;
+		return;
+	}
+	for (u8 ps = 0; ps < PS_DISABLE; ps++) {
+		count = clk / (Freq * (1U << (ps + 1)));
+		if (count < 65536U) {
+			*Interval = (XInterval)count;
+			*Prescaler = ps;
+			return;
+		}
+	}
+}
+
+void XTtcPs_SetPrescaler(XTtcPs *InstancePtr, u8 PrescalerValue) {
+	InstancePtr->Prescaler = PrescalerValue;
+}
+
+void XTtcPs_SetInterval(XTtcPs *InstancePtr, XInterval Value) {
+	InstancePtr->Interval = Value;
+}
+
+void XTtcPs_SetMatchValue(XTtcPs *InstancePtr, u8 MatchIndex, XMatchpoint Value) {
+	if (MatchIndex < XTTCPS_NUM_MATCH_REG) InstancePtr->Match[MatchIndex] = Value;
+}
+
+void XTtcPs_Start(XTtcPs *InstancePtr) {
+	if (!InstancePtr->Running) {
+		ttcDeadline = now + ttc_period();
+		ttcStart = now;
+	}
+	InstancePtr->Running = 1;
+}
+
+void XTtcPs_Stop(XTtcPs *InstancePtr) {
+	InstancePtr->Running = 0;
+}
+
+void XTtcPs_ResetCounterValue(XTtcPs *InstancePtr) {
+	ttcDeadline = now + ttc_period();
+	ttcStart = now;
+}
+
+u32 XTtcPs_GetCounterValue(XTtcPs *InstancePtr) {
+	if (InstancePtr->Options & XTTCPS_OPTION_INTERVAL_MODE)
+		return (u32)ttc_ticks(now) % ((u32)InstancePtr->Interval + 1);
+	return (u32)(ttc_ticks(now) & 0xFFFF);
+}
+
+void XTtcPs_EnableInterrupts(XTtcPs *InstancePtr, u32 InterruptMask) {
+	InstancePtr->IntrMask |= InterruptMask;
+	deliver();
+}
+
+void XTtcPs_DisableInterrupts(XTtcPs *InstancePtr, u32 InterruptMask) {
+	InstancePtr->IntrMask &= ~InterruptMask;
+}
+
+u32 XTtcPs_GetInterruptStatus(XTtcPs *InstancePtr) {
+	return InstancePtr->IntrStatus;
+}
+
+void XTtcPs_ClearInterruptStatus(XTtcPs *InstancePtr, u32 InterruptMask) {
+	InstancePtr->IntrStatus &= ~InterruptMask;
+}
+
+static bool ttc_line(void) {
+	return ttc != NULL && (ttc->IntrStatus & ttc->IntrMask) != 0;
+}
+
+u64 sim_ttc_next(void) {
+	u64 next = ttc_next_time();
+
+	if (next == SIM_NEVER) return 0;
+	return (next > now) ? next - now : 1;
+}
+
+/****************************** XADC *****************************/
+
+static XAdcPs_Config adcConfig = { XPAR_XADCPS_0_DEVICE_ID, XPAR_XADCPS_0_BASEADDR };
+static u16 adcData[XADCPS_CH_MAX];
+static u16 adcNoise[XADCPS_CH_MAX];		/* peak noise added to each conversion */
+static u32 adcSeed = 1;					/* noise is repeatable run to run */
+
+// conversions queued by sim_adc_push, taken one per read
+#define ADC_QUEUE 	256
+static struct { u8 channel; u16 raw; } adcQueue[ADC_QUEUE];
+static u32 adcHead = 0;
+static u32 adcCount = 0;
+
+XAdcPs_Config *XAdcPs_LookupConfig(u16 DeviceId) {
+	return (DeviceId == adcConfig.DeviceId) ? &adcConfig : NULL;
+}
+
+s32 XAdcPs_CfgInitialize(XAdcPs *InstancePtr, XAdcPs_Config *ConfigPtr, u32 EffectiveAddr) {
+	if (InstancePtr == NULL || ConfigPtr == NULL) return XST_FAILURE;
+	InstancePtr->Config = *ConfigPtr;
+	InstancePtr->Config.BaseAddress = EffectiveAddr;
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	return XST_SUCCESS;
+}
+
+void XAdcPs_SetSequencerMode(XAdcPs *InstancePtr, u8 SequencerMode) {
+	InstancePtr->SequencerMode = SequencerMode;
+}
+
+void XAdcPs_SetAlarmEnables(XAdcPs *InstancePtr, u16 AlmEnableMask) {
+	InstancePtr->AlarmEnables = AlmEnableMask;
+}
+
+s32 XAdcPs_SetSeqChEnables(XAdcPs *InstancePtr, u32 ChEnableMask) {
+	InstancePtr->SeqChEnables = ChEnableMask;
+	return XST_SUCCESS;
+}
+
+u16 XAdcPs_GetAdcData(XAdcPs *InstancePtr, u8 Channel) {
+	s32 v;
+
+	if (Channel >= XADCPS_CH_MAX) return 0;
+	if (adcCount > 0 && adcQueue[adcHead].channel == Channel) {
+		// a queued conversion, which holds until the next
+		adcData[Channel] = adcQueue[adcHead].raw;
+		adcNoise[Channel] = 0;
+		adcHead = (adcHead + 1) % ADC_QUEUE;
+		adcCount--;
+		return adcData[Channel];
+	}
+	v = adcData[Channel];
+	if (adcNoise[Channel] > 0) {
+		adcSeed = adcSeed * 1103515245U + 12345U;
+		v += (s32)((adcSeed >> 8) % (2U * adcNoise[Channel] + 1)) - adcNoise[Channel];
+	}
+	return (u16)((v < 0) ? 0 : (v > 0xFFFF) ? 0xFFFF : v);
+}
+
+void sim_adc_set(u8 channel, u16 raw, u16 noise) {
+	if (channel >= XADCPS_CH_MAX) return;
+	adcData[channel] = raw;
+	adcNoise[channel] = noise;
+}
+
+void sim_adc_push(u8 channel, u16 raw) {
+	if (channel >= XADCPS_CH_MAX) return;
+	if (adcCount == ADC_QUEUE) {
+		// nobody is reading, keep the latest
+		adcHead = (adcHead + 1) % ADC_QUEUE;
+		adcCount--;
+	}
+	adcQueue[(adcHead + adcCount) % ADC_QUEUE].channel = channel;
+	adcQueue[(adcHead + adcCount) % ADC_QUEUE].raw = raw;
+	adcCount++;
+}
+
+/****************************** AXI TIMER *****************************/
+
+static XTmrCtr *tmrCtr = NULL;			/* the instance driving the servo */
+
+int XTmrCtr_Initialize(XTmrCtr *InstancePtr, u16 DeviceId) {
+	if (DeviceId != XPAR_AXI_TIMER_0_DEVICE_ID) return XST_FAILURE;
+	memset(InstancePtr, 0, sizeof(XTmrCtr));
+	InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+	tmrCtr = InstancePtr;
+	return XST_SUCCESS;
+}
+
+void XTmrCtr_SetOptions(XTmrCtr *InstancePtr, u8 TmrCtrNumber, u32 Options) {
+	InstancePtr->Options[TmrCtrNumber] = Options;
+}
+
+u32 XTmrCtr_GetOptions(XTmrCtr *InstancePtr, u8 TmrCtrNumber) {
+	return InstancePtr->Options[TmrCtrNumber];
+}
+
+void XTmrCtr_SetResetValue(XTmrCtr *InstancePtr, u8 TmrCtrNumber, u32 ResetValue) {
+	InstancePtr->ResetValue[TmrCtrNumber] = ResetValue;
+}
+
+void XTmrCtr_Start(XTmrCtr *InstancePtr, u8 TmrCtrNumber) {
+	if (TmrCtrNumber == XTC_TIMER_0) InstancePtr->IsStartedTmrCtr0 = XIL_COMPONENT_IS_READY;
+	else InstancePtr->IsStartedTmrCtr1 = XIL_COMPONENT_IS_READY;
+}
+
+void XTmrCtr_Stop(XTmrCtr *InstancePtr, u8 TmrCtrNumber) {
+	if (TmrCtrNumber == XTC_TIMER_0) InstancePtr->IsStartedTmrCtr0 = 0;
+	else InstancePtr->IsStartedTmrCtr1 = 0;
+}
+
+double sim_servo_duty(void) {
+	if (tmrCtr == NULL) return 0;
+
+	// up-counting pwm: each timer runs from its load value to overflow (c.f. servo.c)
+	u64 period = 0xFFFFFFFFULL - tmrCtr->ResetValue[XTC_TIMER_0] + 2;
+	u64 high = 0xFFFFFFFFULL - tmrCtr->ResetValue[XTC_TIMER_1] + 2;
+	return 100.0 * (double)high / (double)period;
+}
+
+/****************************** TIME *****************************/
+
+u64 sim_now(void) {
+	return now;
+}
+
+void XTime_GetTime(XTime *Xtime_Global) {
+	*Xtime_Global = (XTime)((unsigned __int128)now * COUNTS_PER_SECOND / 1000000000ULL);
+}
+
+void sim_advance(u64 ns) {
+	u64 end = now + ns;
+
+	// each interval or match that comes up on the way raises the TTC interrupt
+	for (u64 t = ttc_next_time(); t <= end; t = ttc_next_time()) {
+		now = t;
+		if (ttc->Options & XTTCPS_OPTION_INTERVAL_MODE) {
+			ttcDeadline += ttc_period();
+			ttc->IntrStatus |= XTTCPS_IXR_INTERVAL_MASK;
+		}
+		else ttc->IntrStatus |= XTTCPS_IXR_MATCH_0_MASK;
+		deliver();
+	}
+	now = end;
+	deliver();
+}
+
+/****************************** LINES *****************************/
+
+static bool line_asserted(u32 id) {
+	if (id == XPAR_XTTCPS_0_INTR) return ttc_line();
+	for (u16 dev = 0; dev < NUM_GPIO; dev++)
+		if (gpioIntr[dev] == id) return gpio_line(dev);
+	for (int u = 0; u < NUM_UART; u++)
+		if (uartIntr[u] == id) return uart_line(u);
+	return false;
+}
+
+/****************************** PLATFORM *****************************/
+
+/*
+ * a firmware built with REC_ENABLE leaves its recording in $TCS_RECORD,
+ * however the process ends: the FSM reaching DONE, a script running out or
+ * the q command
+ */
+static void save_recording(void) {
+	const char *name = getenv("TCS_RECORD");
+	FILE *fp;
+
+	if (name == NULL) return;
+	if (rec_size() == 0) {
+		fprintf(stderr, "[sim] %s: nothing recorded, build with -DREC_ENABLE=1\n", name);
+		return;
+	}
+	if ((fp = fopen(name, "wb")) == NULL || fwrite(rec_data(), 1, rec_size(), fp) != rec_size()) perror(name);
+	if (fp != NULL) fclose(fp);
+}
+
+void init_platform(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);	/* tty output shows up as it is sent */
+	atexit(&save_recording);
+}
+
+void cleanup_platform(void) {
+	fflush(stdout);
+}
@@ -0,0 +1,7 @@
+/*
+ * platform.h -- host stand-in, nothing to bring up
+ */
+#pragma once
+
+void init_platform(void);
+void cleanup_platform(void);
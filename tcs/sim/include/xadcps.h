@@ -0,0 +1,49 @@
+/*
+ * xadcps.h -- host stand-in for the XADC driver, the simulator sets the
+ * raw conversion results
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XADCPS_CH_TEMP 		0x0U
+#define XADCPS_CH_VCCINT 	0x1U
+#define XADCPS_CH_VCCAUX 	0x2U
+#define XADCPS_CH_AUX_MIN 	16U
+#define XADCPS_CH_AUX_MAX 	31U
+#define XADCPS_AUX14_OFFSET 0x78U	/* the register offset adc.c passes as a channel */
+#define XADCPS_CH_MAX 		0x80U
+
+#define XADCPS_SEQ_CH_VCCINT 	0x00000200U
+#define XADCPS_SEQ_CH_TEMP 		0x00000100U
+#define XADCPS_SEQ_CH_AUX14 	0x40000000U
+
+#define XADCPS_SEQ_MODE_SAFE 		0U
+#define XADCPS_SEQ_MODE_ONEPASS 	1U
+#define XADCPS_SEQ_MODE_CONTINPASS 	2U
+#define XADCPS_SEQ_MODE_SINGCHAN 	3U
+
+#define XAdcPs_RawToTemperature(AdcData) \
+	((((float)(AdcData)/65536.0f)/0.00198421639f ) - 273.15f)
+#define XAdcPs_RawToVoltage(AdcData) \
+	((((float)(AdcData))* (3.0f))/65536.0f)
+
+typedef struct {
+	u16 DeviceId;
+	u32 BaseAddress;
+} XAdcPs_Config;
+
+typedef struct {
+	XAdcPs_Config Config;
+	u32 IsReady;
+	u8 SequencerMode;
+	u32 SeqChEnables;
+	u32 AlarmEnables;
+} XAdcPs;
+
+XAdcPs_Config *XAdcPs_LookupConfig(u16 DeviceId);
+s32 XAdcPs_CfgInitialize(XAdcPs *InstancePtr, XAdcPs_Config *ConfigPtr, u32 EffectiveAddr);
+void XAdcPs_SetSequencerMode(XAdcPs *InstancePtr, u8 SequencerMode);
+void XAdcPs_SetAlarmEnables(XAdcPs *InstancePtr, u16 AlmEnableMask);
+s32 XAdcPs_SetSeqChEnables(XAdcPs *InstancePtr, u32 ChEnableMask);
+u16 XAdcPs_GetAdcData(XAdcPs *InstancePtr, u8 Channel);
@@ -0,0 +1,26 @@
+/*
+ * xgpio.h -- host stand-in for the AXI GPIO driver, channel 1 only
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XGPIO_IR_CH1_MASK 0x1U
+#define XGPIO_IR_CH2_MASK 0x2U
+
+typedef struct {
+	UINTPTR BaseAddress;
+	u32 IsReady;
+	u16 DeviceId;
+} XGpio;
+
+int XGpio_Initialize(XGpio *InstancePtr, u16 DeviceId);
+void XGpio_SetDataDirection(XGpio *InstancePtr, unsigned Channel, u32 DirectionMask);
+u32 XGpio_DiscreteRead(XGpio *InstancePtr, unsigned Channel);
+void XGpio_DiscreteWrite(XGpio *InstancePtr, unsigned Channel, u32 Mask);
+void XGpio_InterruptGlobalEnable(XGpio *InstancePtr);
+void XGpio_InterruptGlobalDisable(XGpio *InstancePtr);
+void XGpio_InterruptEnable(XGpio *InstancePtr, u32 Mask);
+void XGpio_InterruptDisable(XGpio *InstancePtr, u32 Mask);
+void XGpio_InterruptClear(XGpio *InstancePtr, u32 Mask);
+u32 XGpio_InterruptGetStatus(XGpio *InstancePtr);
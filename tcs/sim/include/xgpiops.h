@@ -0,0 +1,25 @@
+/*
+ * xgpiops.h -- host stand-in for the PS GPIO driver
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XGPIOPS_MAX_PINS 118U
+
+typedef struct {
+	u16 DeviceId;
+	u32 BaseAddr;
+} XGpioPs_Config;
+
+typedef struct {
+	XGpioPs_Config GpioConfig;
+	u32 IsReady;
+} XGpioPs;
+
+XGpioPs_Config *XGpioPs_LookupConfig(u16 DeviceId);
+s32 XGpioPs_CfgInitialize(XGpioPs *InstancePtr, const XGpioPs_Config *ConfigPtr, u32 EffectiveAddr);
+void XGpioPs_SetDirectionPin(XGpioPs *InstancePtr, u32 Pin, u32 Direction);
+void XGpioPs_SetOutputEnablePin(XGpioPs *InstancePtr, u32 Pin, u32 OpEnable);
+void XGpioPs_WritePin(XGpioPs *InstancePtr, u32 Pin, u32 Data);
+u32 XGpioPs_ReadPin(XGpioPs *InstancePtr, u32 Pin);
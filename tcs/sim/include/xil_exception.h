@@ -0,0 +1,15 @@
+/*
+ * xil_exception.h -- host stand-in, the cpu irq mask is simulated
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XIL_EXCEPTION_ID_INT 5U
+
+typedef void (*Xil_ExceptionHandler)(void *data);
+
+void Xil_ExceptionRegisterHandler(u32 Exception_id, Xil_ExceptionHandler Handler, void *Data);
+void Xil_ExceptionRemoveHandler(u32 Exception_id);
+void Xil_ExceptionEnable(void);
+void Xil_ExceptionDisable(void);
@@ -0,0 +1,51 @@
+/*
+ * xparameters.h -- host stand-in, the subset of the Zybo Z7 hardware
+ * definitions (c.f. tcs/extras/hardware/xparameters.h) used by the TCS
+ */
+#pragma once
+
+/* AXI GPIO: leds 0-3, buttons, switches, led6 */
+#define XPAR_AXI_GPIO_0_DEVICE_ID 0
+#define XPAR_AXI_GPIO_1_DEVICE_ID 1
+#define XPAR_AXI_GPIO_2_DEVICE_ID 2
+#define XPAR_AXI_GPIO_3_DEVICE_ID 3
+#define XPAR_AXI_GPIO_0_BASEADDR 0x41200000
+#define XPAR_AXI_GPIO_1_BASEADDR 0x41210000
+#define XPAR_AXI_GPIO_2_BASEADDR 0x41220000
+#define XPAR_AXI_GPIO_3_BASEADDR 0x41230000
+#define XPAR_FABRIC_GPIO_1_VEC_ID 61U
+#define XPAR_FABRIC_GPIO_2_VEC_ID 62U
+
+/* PS GPIO: led4 on MIO7 */
+#define XPAR_PS7_GPIO_0_DEVICE_ID 0
+#define XPAR_PS7_GPIO_0_BASEADDR 0xE000A000
+
+/* GIC */
+#define XPAR_PS7_SCUGIC_0_DEVICE_ID 0U
+#define XPAR_PS7_SCUGIC_0_BASEADDR 0xF8F00100
+
+/* AXI timer driving the servo */
+#define XPAR_AXI_TIMER_0_DEVICE_ID 0U
+#define XPAR_AXI_TIMER_0_CLOCK_FREQ_HZ 50000000U
+
+/* triple timer counter */
+#define XPAR_XTTCPS_0_DEVICE_ID 0U
+#define XPAR_XTTCPS_0_BASEADDR 0xF8001000U
+#define XPAR_XTTCPS_0_TTC_CLK_FREQ_HZ 111111115U
+#define XPAR_XTTCPS_0_INTR 42U
+
+/* uart0 (wifi), uart1 (tty) */
+#define XPAR_PS7_UART_0_DEVICE_ID 0
+#define XPAR_PS7_UART_1_DEVICE_ID 1
+#define XPAR_PS7_UART_0_BASEADDR 0xE0000000
+#define XPAR_PS7_UART_1_BASEADDR 0xE0001000
+#define XPAR_XUARTPS_0_INTR 59U
+#define XPAR_XUARTPS_1_INTR 82U
+
+/* xadc */
+#define XPAR_XADCPS_0_DEVICE_ID 0
+#define XPAR_XADCPS_0_BASEADDR 0xF8007100
+
+/* cpu, the global timer runs at half of it */
+#define XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ 666666687
+#define XPAR_CPU_CORTEXA9_CORE_CLOCK_FREQ_HZ XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ
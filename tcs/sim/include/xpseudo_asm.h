@@ -0,0 +1,24 @@
+/*
+ * xpseudo_asm.h -- host stand-in for the cortex-a9 instructions we use
+ *
+ * the cpsr only models the I (irq mask) bit; wfi hands control to the
+ * simulator until an interrupt is pending; the pmu cycle counter reads the
+ * host's monotonic clock, scaled to the cpu clock
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XIL_EXCEPTION_IRQ 0x80U		/* cpsr I bit */
+
+u32 sim_mfcpsr(void);
+void sim_mtcpsr(u32 cpsr);
+void sim_wfi(void);
+u32 sim_mfcp(u32 reg);
+void sim_mtcp(u32 reg, u32 value);
+
+#define mfcpsr()	sim_mfcpsr()
+#define mtcpsr(v)	sim_mtcpsr(v)
+#define wfi()		sim_wfi()
+#define mfcp(rn)	sim_mfcp(rn)
+#define mtcp(rn, v)	sim_mtcp(rn, v)
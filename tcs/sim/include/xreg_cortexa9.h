@@ -0,0 +1,9 @@
+/*
+ * xreg_cortexa9.h -- host stand-in, the cp15 registers the TCS touches,
+ * named by number for sim_mfcp/sim_mtcp (c.f. xpseudo_asm.h)
+ */
+#pragma once
+
+#define XREG_CP15_PERF_MONITOR_CTRL 	1U
+#define XREG_CP15_COUNT_ENABLE_SET 		2U
+#define XREG_CP15_PERF_CYCLE_COUNTER 	3U
@@ -0,0 +1,36 @@
+/*
+ * xscugic.h -- host stand-in, a virtual GIC that dispatches to the
+ * handlers connected to it when the simulator raises an interrupt id
+ */
+#pragma once
+
+#include "xil_types.h"
+#include "xil_exception.h"
+
+#define XSCUGIC_MAX_NUM_INTR_INPUTS 95U
+
+typedef struct {
+	u16 DeviceId;
+	u32 CpuBaseAddress;
+	u32 DistBaseAddress;
+} XScuGic_Config;
+
+typedef struct {
+	XScuGic_Config *Config;
+	u32 IsReady;
+} XScuGic;
+
+XScuGic_Config *XScuGic_LookupConfig(u16 DeviceId);
+s32 XScuGic_CfgInitialize(XScuGic *InstancePtr, XScuGic_Config *ConfigPtr, u32 EffectiveAddr);
+s32 XScuGic_Connect(XScuGic *InstancePtr, u32 Int_Id, Xil_InterruptHandler Handler, void *CallBackRef);
+void XScuGic_Disconnect(XScuGic *InstancePtr, u32 Int_Id);
+void XScuGic_Enable(XScuGic *InstancePtr, u32 Int_Id);
+void XScuGic_Disable(XScuGic *InstancePtr, u32 Int_Id);
+void XScuGic_Stop(XScuGic *InstancePtr);
+void XScuGic_InterruptHandler(XScuGic *InstancePtr);
+
+#define XSCUGIC_HI_PEND_OFFSET 	0x18U		/* highest priority pending interrupt */
+#define XSCUGIC_ACK_INTID_MASK 	0x3FFU
+
+/* reads the simulated cpu interface, only the hi-pending register */
+u32 XScuGic_CPUReadReg(XScuGic *InstancePtr, u32 RegOffset);
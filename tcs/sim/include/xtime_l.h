@@ -0,0 +1,13 @@
+/*
+ * xtime_l.h -- host stand-in, the global timer counts simulated time
+ */
+#pragma once
+
+#include "xil_types.h"
+#include "xparameters.h"
+
+typedef u64 XTime;
+
+#define COUNTS_PER_SECOND (XPAR_CPU_CORTEXA9_CORE_CLOCK_FREQ_HZ / 2)
+
+void XTime_GetTime(XTime *Xtime_Global);
@@ -0,0 +1,38 @@
+/*
+ * xtmrctr.h -- host stand-in for the AXI timer driver, the simulator
+ * reads back the load values to recover the servo's pwm duty cycle
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XTC_TIMER_0 0
+#define XTC_TIMER_1 1
+#define XTC_DEVICE_TIMER_COUNT 2
+
+#define XTC_CASCADE_MODE_OPTION 	0x00000080UL
+#define XTC_ENABLE_ALL_OPTION 		0x00000040UL
+#define XTC_DOWN_COUNT_OPTION 		0x00000020UL
+#define XTC_CAPTURE_MODE_OPTION 	0x00000010UL
+#define XTC_INT_MODE_OPTION 		0x00000008UL
+#define XTC_AUTO_RELOAD_OPTION 		0x00000004UL
+#define XTC_EXT_COMPARE_OPTION 		0x00000002UL
+#define XTC_PWM_ENABLE_OPTION 		0x00000001UL
+
+#define XTC_HZ_TO_NS(Hz) ((1000000000 / (Hz)))
+
+typedef struct {
+	UINTPTR BaseAddress;
+	u32 IsReady;
+	u32 IsStartedTmrCtr0;
+	u32 IsStartedTmrCtr1;
+	u32 Options[XTC_DEVICE_TIMER_COUNT];
+	u32 ResetValue[XTC_DEVICE_TIMER_COUNT];
+} XTmrCtr;
+
+int XTmrCtr_Initialize(XTmrCtr *InstancePtr, u16 DeviceId);
+void XTmrCtr_SetOptions(XTmrCtr *InstancePtr, u8 TmrCtrNumber, u32 Options);
+u32 XTmrCtr_GetOptions(XTmrCtr *InstancePtr, u8 TmrCtrNumber);
+void XTmrCtr_SetResetValue(XTmrCtr *InstancePtr, u8 TmrCtrNumber, u32 ResetValue);
+void XTmrCtr_Start(XTmrCtr *InstancePtr, u8 TmrCtrNumber);
+void XTmrCtr_Stop(XTmrCtr *InstancePtr, u8 TmrCtrNumber);
@@ -0,0 +1,63 @@
+/*
+ * xttcps.h -- host stand-in for the triple timer counter driver, the
+ * simulator decides when an interval elapses or a match comes up
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XTTCPS_OPTION_EXTERNAL_CLK 		0x00000001U
+#define XTTCPS_OPTION_CLK_EDGE_NEG 		0x00000002U
+#define XTTCPS_OPTION_INTERVAL_MODE		0x00000004U
+#define XTTCPS_OPTION_DECREMENT 		0x00000008U
+#define XTTCPS_OPTION_MATCH_MODE 		0x00000010U
+#define XTTCPS_OPTION_WAVE_DISABLE 		0x00000020U
+#define XTTCPS_OPTION_WAVE_POLARITY 	0x00000040U
+
+#define XTTCPS_IXR_INTERVAL_MASK 	0x00000001U
+#define XTTCPS_IXR_MATCH_0_MASK 	0x00000002U
+#define XTTCPS_IXR_MATCH_1_MASK 	0x00000004U
+#define XTTCPS_IXR_MATCH_2_MASK 	0x00000008U
+#define XTTCPS_IXR_CNT_OVR_MASK 	0x00000010U
+#define XTTCPS_IXR_ALL_MASK 		0x0000001FU
+
+#define XTTCPS_MAX_INTERVAL_COUNT 0xFFFFU
+#define XTTCPS_NUM_MATCH_REG 3U
+
+typedef u16 XInterval;
+typedef u16 XMatchpoint;
+
+typedef struct {
+	u16 DeviceId;
+	u32 BaseAddress;
+	u32 InputClockHz;
+} XTtcPs_Config;
+
+typedef struct {
+	XTtcPs_Config Config;
+	u32 IsReady;
+	u32 Options;
+	XInterval Interval;
+	u8 Prescaler;				/* 16 means no prescaling */
+	XMatchpoint Match[XTTCPS_NUM_MATCH_REG];
+	u32 IntrMask;
+	u32 IntrStatus;
+	u32 Running;
+} XTtcPs;
+
+XTtcPs_Config *XTtcPs_LookupConfig(u16 DeviceId);
+s32 XTtcPs_CfgInitialize(XTtcPs *InstancePtr, XTtcPs_Config *ConfigPtr, u32 EffectiveAddr);
+s32 XTtcPs_SetOptions(XTtcPs *InstancePtr, u32 Options);
+u32 XTtcPs_GetOptions(XTtcPs *InstancePtr);
+void XTtcPs_CalcIntervalFromFreq(XTtcPs *InstancePtr, u32 Freq, XInterval *Interval, u8 *Prescaler);
+void XTtcPs_SetPrescaler(XTtcPs *InstancePtr, u8 PrescalerValue);
+void XTtcPs_SetInterval(XTtcPs *InstancePtr, XInterval Value);
+void XTtcPs_SetMatchValue(XTtcPs *InstancePtr, u8 MatchIndex, XMatchpoint Value);
+void XTtcPs_Start(XTtcPs *InstancePtr);
+void XTtcPs_Stop(XTtcPs *InstancePtr);
+void XTtcPs_ResetCounterValue(XTtcPs *InstancePtr);
+u32 XTtcPs_GetCounterValue(XTtcPs *InstancePtr);
+void XTtcPs_EnableInterrupts(XTtcPs *InstancePtr, u32 InterruptMask);
+void XTtcPs_DisableInterrupts(XTtcPs *InstancePtr, u32 InterruptMask);
+u32 XTtcPs_GetInterruptStatus(XTtcPs *InstancePtr);
+void XTtcPs_ClearInterruptStatus(XTtcPs *InstancePtr, u32 InterruptMask);
@@ -0,0 +1,79 @@
+/*
+ * xuartps.h -- host stand-in for the PS UART driver
+ *
+ * registers are simulated per base address; XUartPs_InterruptHandler
+ * turns the simulated status into the same events the real driver raises
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define XUARTPS_DFT_BAUDRATE 115200U
+#define XUARTPS_FIFO_SIZE 64U
+
+/* register offsets */
+#define XUARTPS_CR_OFFSET 	0x0000U
+#define XUARTPS_IER_OFFSET 	0x0008U
+#define XUARTPS_IDR_OFFSET 	0x000CU
+#define XUARTPS_IMR_OFFSET 	0x0010U
+#define XUARTPS_ISR_OFFSET 	0x0014U
+#define XUARTPS_SR_OFFSET 	0x002CU
+#define XUARTPS_FIFO_OFFSET	0x0030U
+
+#define XUARTPS_CR_TORST 	0x00000040U
+
+/* interrupt bits */
+#define XUARTPS_IXR_RXOVR 	0x00000001U
+#define XUARTPS_IXR_RXFULL 	0x00000002U
+#define XUARTPS_IXR_RXEMPTY 0x00000004U
+#define XUARTPS_IXR_TXEMPTY 0x00000008U
+#define XUARTPS_IXR_TXFULL 	0x00000010U
+#define XUARTPS_IXR_OVER 	0x00000020U
+#define XUARTPS_IXR_TOUT 	0x00000100U
+
+/* status bits */
+#define XUARTPS_SR_RXEMPTY 	0x00000002U
+#define XUARTPS_SR_TXFULL 	0x00000010U
+
+/* handler events */
+#define XUARTPS_EVENT_RECV_DATA 	1U
+#define XUARTPS_EVENT_RECV_TOUT 	2U
+#define XUARTPS_EVENT_SENT_DATA 	3U
+#define XUARTPS_EVENT_RECV_ERROR 	4U
+
+typedef void (*XUartPs_Handler)(void *CallBackRef, u32 Event, u32 EventData);
+
+typedef struct {
+	u16 DeviceId;
+	u32 BaseAddress;
+	u32 InputClockHz;
+} XUartPs_Config;
+
+typedef struct {
+	XUartPs_Config Config;
+	u32 IsReady;
+	u32 BaudRate;
+	XUartPs_Handler Handler;
+	void *CallBackRef;
+} XUartPs;
+
+u32 XUartPs_ReadReg(u32 BaseAddress, u32 RegOffset);
+void XUartPs_WriteReg(u32 BaseAddress, u32 RegOffset, u32 RegisterValue);
+
+#define XUartPs_IsReceiveData(BaseAddress) \
+	!((XUartPs_ReadReg((BaseAddress), XUARTPS_SR_OFFSET) & XUARTPS_SR_RXEMPTY) == XUARTPS_SR_RXEMPTY)
+#define XUartPs_IsTransmitFull(BaseAddress) \
+	((XUartPs_ReadReg((BaseAddress), XUARTPS_SR_OFFSET) & XUARTPS_SR_TXFULL) == XUARTPS_SR_TXFULL)
+
+XUartPs_Config *XUartPs_LookupConfig(u16 DeviceId);
+s32 XUartPs_CfgInitialize(XUartPs *InstancePtr, XUartPs_Config *Config, u32 EffectiveAddr);
+void XUartPs_DisableUart(XUartPs *InstancePtr);
+void XUartPs_EnableUart(XUartPs *InstancePtr);
+s32 XUartPs_SetBaudRate(XUartPs *InstancePtr, u32 BaudRate);
+void XUartPs_SetFifoThreshold(XUartPs *InstancePtr, u8 TriggerLevel);
+void XUartPs_SetRecvTimeout(XUartPs *InstancePtr, u8 RecvTimeout);
+void XUartPs_SetInterruptMask(XUartPs *InstancePtr, u32 Mask);
+void XUartPs_SetHandler(XUartPs *InstancePtr, XUartPs_Handler FuncPtr, void *CallBackRef);
+void XUartPs_InterruptHandler(XUartPs *InstancePtr);
+u32 XUartPs_Send(XUartPs *InstancePtr, u8 *BufferPtr, u32 NumBytes);
+u32 XUartPs_Recv(XUartPs *InstancePtr, u8 *BufferPtr, u32 NumBytes);
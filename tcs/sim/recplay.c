@@ -0,0 +1,334 @@
+/*
+ * recplay.c -- replay a field recording in virtual time & check the outputs
+ *
+ * the recording (c.f. final/rec.h; the file named by $TCS_RECORDING, or
+ * stdin) has the inputs the board acted on, and they are put back on the
+ * simulated board at the times they were recorded: button & switch levels,
+ * wifi bytes, and raw pot conversions, which are queued a little ahead of
+ * the read that takes them. wfi() jumps straight to the next input or TTC
+ * interrupt, as in script.c, so hours of traffic replay in well under a
+ * second.
+ *
+ * The firmware, built with REC_ENABLE, records the replay too. At exit the
+ * two recordings' led6, led & servo writes and timer expiries are compared,
+ * each kind in order, up to where the field recording ends; the first
+ * difference of each kind is reported and the exit status is 1 if there
+ * was one.
+ *
+ * Build (from final/):
+ *    gcc -O2 -DREC_ENABLE=1 -I. -I../sim/include -o ../tcs_recplay *.c ../sim/hal.c ../sim/recplay.c
+ * A simulator built with -DREC_ENABLE=1 records to $TCS_RECORD, e.g.
+ *    TCS_SCRIPT=day.txt TCS_RECORD=day.rec ../tcs_replay
+ *    TCS_RECORDING=day.rec ../tcs_recplay
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "xparameters.h"
+#include "xadcps.h"
+#include "xtime_l.h"
+#include "rec.h"
+#include "adc.h"
+
+#define NS_PER_SEC 	1000000000ULL
+#define ADC_LEAD 	(NS_PER_SEC / ADC_SAMPLE_HZ / 2)	/* how far ahead of its read a conversion is queued */
+#define END_SLACK 	1000000ULL		/* ns run past the last record, for its replayed twin */
+
+typedef struct {
+	u64 at;							/* simulated ns */
+	u32 seq;						/* order in the file, breaks ties */
+	u8 type, arg;
+	u32 value;						/* levels, raw conversion, position */
+	const u8 *bytes;				/* REC_UART: arg + 1 of them */
+} record_t;
+
+typedef struct {
+	record_t *recs;
+	u32 n;
+	bool truncated;
+} recording_t;
+
+static u8 *file = NULL;
+static recording_t field;			/* what the board did */
+static record_t *inputs = NULL;		/* field's inputs, in the order they go back in */
+static u32 numInputs = 0;
+static u32 cursor = 0;				/* next input */
+static u64 endAt = 0;				/* a little past the field recording's last record */
+
+static u64 wallStart;
+static u32 wakeups = 0;
+
+static u64 wall_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * NS_PER_SEC + (u64)ts.tv_nsec;
+}
+
+/****************************** PARSING *****************************/
+
+static bool varint(const u8 *buf, u32 len, u32 *pos, u64 *v) {
+	u32 shift;
+
+	*v = 0;
+	for (shift = 0; *pos < len && shift < 64; shift += 7) {
+		u8 b = buf[(*pos)++];
+		*v |= (u64)(b & 0x7F) << shift;
+		if (!(b & 0x80)) return true;
+	}
+	return false;
+}
+
+/*
+ * split a recording into records; times become ns of simulated time, the
+ * first at or after the global timer count it was stamped with
+ */
+static bool parse(const u8 *buf, u32 len, recording_t *out) {
+	u32 pos = REC_HEADER_SIZE, cap = 0;
+	u64 t = 0, v;
+	s64 delta;
+	u8 shift;
+
+	out->recs = NULL;
+	out->n = 0;
+	if (len < REC_HEADER_SIZE || memcmp(buf, "TCSR", 4) != 0 || buf[4] != REC_VERSION) return false;
+	shift = buf[5];
+	out->truncated = (buf[6] & REC_TRUNCATED) != 0;
+
+	while (pos < len) {
+		record_t r;
+
+		memset(&r, 0, sizeof(r));
+		r.type = buf[pos] & ((1U << REC_TYPE_BITS) - 1);
+		r.arg = buf[pos] >> REC_TYPE_BITS;
+		pos++;
+		if (!varint(buf, len, &pos, &v)) return false;
+		delta = (s64)(v >> 1) ^ -(s64)(v & 1);
+		t += (u64)delta;
+
+		switch (r.type) {
+			case REC_GPIO:
+			case REC_SERVO:
+				if (!varint(buf, len, &pos, &v)) return false;
+				r.value = (u32)v;
+				break;
+			case REC_UART:
+				if (pos + r.arg + 1U > len) return false;
+				r.bytes = buf + pos;
+				pos += r.arg + 1U;
+				break;
+			case REC_ADC:
+				if (pos + 2 > len) return false;
+				r.value = buf[pos] | (u32)buf[pos + 1] << 8;
+				pos += 2;
+				break;
+			case REC_TTC:
+			case REC_LED6:
+			case REC_LED:
+				break;
+			default:
+				return false;
+		}
+		r.at = (u64)(((unsigned __int128)(t << shift) * NS_PER_SEC + COUNTS_PER_SECOND - 1) / COUNTS_PER_SECOND);
+		r.seq = out->n;
+
+		if (out->n == cap) {
+			cap = cap ? cap * 2 : 1024;
+			if ((out->recs = realloc(out->recs, cap * sizeof(record_t))) == NULL) {
+				perror("recplay");
+				exit(EXIT_FAILURE);
+			}
+		}
+		out->recs[out->n++] = r;
+	}
+	return true;
+}
+
+static int by_time(const void *a, const void *b) {
+	const record_t *x = a, *y = b;
+
+	if (x->at != y->at) return (x->at < y->at) ? -1 : 1;
+	return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+/****************************** REPLAY *****************************/
+
+static void apply(const record_t *r) {
+	switch (r->type) {
+		case REC_GPIO:
+			sim_gpio_input(r->arg, r->value);
+			break;
+		case REC_UART:
+			sim_uart_rx(XPAR_PS7_UART_0_DEVICE_ID, r->bytes, r->arg + 1U);
+			break;
+		case REC_ADC:
+			sim_adc_push(XADCPS_AUX14_OFFSET, (u16)r->value);
+			break;
+		default:
+			break;
+	}
+}
+
+static void apply_due(void) {
+	while (cursor < numInputs && inputs[cursor].at <= sim_now()) apply(&inputs[cursor++]);
+}
+
+static void advance_to(u64 t) {
+	if (t > sim_now()) sim_advance(t - sim_now());
+}
+
+/*
+ * advance to the next input or TTC interval, whichever is first; done once
+ * the inputs are in and time has reached the end of the field recording
+ */
+static void recplay_wfi(void) {
+	u64 next = (cursor < numInputs) ? inputs[cursor].at : endAt;
+	u64 ttc = sim_ttc_next();
+
+	wakeups++;
+	if (cursor == numInputs && sim_now() >= endAt) exit(EXIT_SUCCESS);
+
+	if (ttc > 0 && sim_now() + ttc < next) next = sim_now() + ttc;
+	advance_to(next);
+	apply_due();
+}
+
+/*
+ * the firmware's sleep() passes simulated time, taking inputs on the way
+ */
+unsigned int sleep(unsigned int seconds) {
+	u64 end = sim_now() + (u64)seconds * NS_PER_SEC;
+
+	while (cursor < numInputs && inputs[cursor].at <= end) {
+		advance_to(inputs[cursor].at);
+		apply_due();
+	}
+	advance_to(end);
+	return 0;
+}
+
+/****************************** CHECK *****************************/
+
+static void describe(char *s, size_t size, const record_t *r) {
+	switch (r->type) {
+		case REC_TTC:	snprintf(s, size, "timer %u", r->arg); break;
+		case REC_LED6:	snprintf(s, size, "color %u", r->arg); break;
+		case REC_LED:	snprintf(s, size, "led %u %s", r->arg >> 1, (r->arg & 1) ? "on" : "off"); break;
+		case REC_SERVO:	snprintf(s, size, "position %u", (unsigned)r->value); break;
+		default:		snprintf(s, size, "?"); break;
+	}
+}
+
+/*
+ * compare one kind of record, in order; true if every field record has a
+ * replayed twin
+ */
+static bool compare(u8 type, const char *name, const recording_t *got, u32 *matched, u64 *skew) {
+	u32 i = 0, j = 0;
+	char want[32], have[32];
+
+	for (;;) {
+		while (i < field.n && field.recs[i].type != type) i++;
+		while (j < got->n && got->recs[j].type != type) j++;
+		if (i == field.n) return true;
+
+		describe(want, sizeof(want), &field.recs[i]);
+		if (j == got->n) {
+			fprintf(stderr, "[recplay] %s #%u at %.6fs: recorded %s, replay has no more\n",
+				name, *matched, (double)field.recs[i].at / NS_PER_SEC, want);
+			return false;
+		}
+		if (field.recs[i].arg != got->recs[j].arg || field.recs[i].value != got->recs[j].value) {
+			describe(have, sizeof(have), &got->recs[j]);
+			fprintf(stderr, "[recplay] %s #%u at %.6fs: recorded %s, replayed %s at %.6fs\n",
+				name, *matched, (double)field.recs[i].at / NS_PER_SEC, want, have, (double)got->recs[j].at / NS_PER_SEC);
+			return false;
+		}
+		u64 d = (field.recs[i].at > got->recs[j].at) ? field.recs[i].at - got->recs[j].at : got->recs[j].at - field.recs[i].at;
+		if (d > *skew) *skew = d;
+		(*matched)++;
+		i++;
+		j++;
+	}
+}
+
+static void done(void) {
+	static const struct { u8 type; const char *name; } kinds[] = {
+		{ REC_LED6, "led6" }, { REC_LED, "led" }, { REC_SERVO, "servo" }, { REC_TTC, "ttc" },
+	};
+	u64 wall = wall_ns() - wallStart;
+	recording_t got;
+	u32 matched[4] = { 0 }, k;
+	u64 skew = 0;
+	bool ok = true;
+
+	fflush(stdout);
+	if (rec_size() == 0 || !parse(rec_data(), rec_size(), &got)) {
+		fprintf(stderr, "[recplay] the firmware recorded nothing, build it with -DREC_ENABLE=1\n");
+		_exit(EXIT_FAILURE);
+	}
+	for (k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+		ok &= compare(kinds[k].type, kinds[k].name, &got, &matched[k], &skew);
+
+	fprintf(stderr, "[recplay] %.3fs replayed in %.3fs (%u wakeups), %u inputs%s\n",
+		(double)sim_now() / NS_PER_SEC, (double)wall / NS_PER_SEC, wakeups, numInputs,
+		field.truncated ? ", recording truncated" : "");
+	fprintf(stderr, "[recplay] %s: led6 %u, led %u, servo %u, ttc %u; max skew %.3fms\n",
+		ok ? "match" : "MISMATCH", matched[0], matched[1], matched[2], matched[3], (double)skew / 1e6);
+	if (!ok) _exit(EXIT_FAILURE);
+}
+
+__attribute__((constructor))
+static void recplay_init(void) {
+	const char *name = getenv("TCS_RECORDING");
+	FILE *fp = stdin;
+	size_t len = 0, cap = 0, got;
+	u32 i;
+
+	if (name != NULL && (fp = fopen(name, "rb")) == NULL) {
+		perror(name);
+		exit(EXIT_FAILURE);
+	}
+	do {
+		if (len == cap && (file = realloc(file, cap = cap ? cap * 2 : 65536)) == NULL) {
+			perror("recplay");
+			exit(EXIT_FAILURE);
+		}
+		got = fread(file + len, 1, cap - len, fp);
+		len += got;
+	} while (got > 0);
+	if (fp != stdin) fclose(fp);
+
+	if (!parse(file, (u32)len, &field)) {
+		fprintf(stderr, "[recplay] %s: not a recording, or cut short\n", name ? name : "stdin");
+		exit(EXIT_FAILURE);
+	}
+	if (field.n == 0) {
+		fprintf(stderr, "[recplay] %s: the recording is empty\n", name ? name : "stdin");
+		exit(EXIT_FAILURE);
+	}
+
+	// the inputs, in time order; a conversion goes in ahead of its read
+	inputs = malloc((field.n + 1) * sizeof(record_t));
+	if (inputs == NULL) {
+		perror("recplay");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < field.n; i++) {
+		record_t r = field.recs[i];
+		if (r.at + END_SLACK > endAt) endAt = r.at + END_SLACK;
+		if (r.type != REC_GPIO && r.type != REC_UART && r.type != REC_ADC) continue;
+		if (r.type == REC_ADC) r.at = (r.at > ADC_LEAD) ? r.at - ADC_LEAD : 0;
+		inputs[numInputs++] = r;
+	}
+	qsort(inputs, numInputs, sizeof(record_t), &by_time);
+
+	wallStart = wall_ns();
+	atexit(&done);
+	sim_set_wfi(&recplay_wfi);
+}
@@ -0,0 +1,123 @@
+/*
+ * script.c -- replay a timestamped event script in virtual time
+ *
+ * the script (the file named by $TCS_SCRIPT, or stdin) has one event per
+ * line, a time since power on followed by an event command (c.f. events.c):
+ *    # morning rush
+ *    0:00:02     n 27 2 1
+ *    0:05:00.5   b 0
+ *    7:30:00     s 1
+ * times are [[h:]m:]s, '#' starts a comment. wfi() jumps simulated time
+ * straight to whatever happens next, a scripted event or a TTC interval,
+ * so a day of traffic replays in however long the firmware takes to run
+ * it. The replay ends after the last event.
+ *
+ * Build (from final/):
+ *    gcc -O2 -I. -I../sim/include -o ../tcs_replay *.c ../sim/hal.c ../sim/events.c ../sim/script.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define NS_PER_SEC 1000000000ULL
+
+static u64 wallStart;
+static u32 wakeups = 0;				/* wfi calls, each one a jump in time */
+
+static u64 wall_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * NS_PER_SEC + (u64)ts.tv_nsec;
+}
+
+/*
+ * parse [[h:]m:]s at *p into ns, leaving *p after it; false if malformed
+ */
+static bool parse_time(char **p, u64 *ns) {
+	double secs = 0, field;
+	char *end;
+
+	for (;;) {
+		field = strtod(*p, &end);
+		if (end == *p || field < 0) return false;
+		secs = secs * 60 + field;
+		*p = end;
+		if (**p != ':') break;
+		(*p)++;
+	}
+	*ns = (u64)(secs * NS_PER_SEC + 0.5);
+	return true;
+}
+
+static void load(FILE *fp, const char *name) {
+	char line[1024];
+	int lineNo = 0;
+	char *p;
+	u64 at;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineNo++;
+		if ((p = strchr(line, '#')) != NULL) *p = '\0';
+		for (p = line; isspace((unsigned char)*p); p++);
+		if (*p == '\0') continue;
+
+		if (!parse_time(&p, &at)) {
+			fprintf(stderr, "[replay] %s:%d: bad time\n", name, lineNo);
+			exit(EXIT_FAILURE);
+		}
+		sim_schedule(at, p);
+	}
+}
+
+static void done(void) {
+	u64 wall = wall_ns() - wallStart;
+
+	fprintf(stderr, "[replay] %.3fs simulated in %.3fs (%u wakeups)\n",
+		(double)sim_now() / NS_PER_SEC, (double)wall / NS_PER_SEC, wakeups);
+}
+
+/*
+ * advance to the next scripted event or TTC interval, whichever is first
+ */
+static void replay_wfi(void) {
+	u64 next = sim_next_event();
+	u64 ttc = sim_ttc_next();
+
+	wakeups++;
+	if (next == SIM_NEVER) exit(EXIT_SUCCESS);		/* nothing left that could wake us */
+
+	if (ttc > 0 && sim_now() + ttc < next) next = sim_now() + ttc;
+	if (next > sim_now()) sim_advance(next - sim_now());
+	sim_run_events();
+}
+
+/*
+ * the firmware's sleep() passes simulated time too
+ */
+unsigned int sleep(unsigned int seconds) {
+	sim_advance((u64)seconds * NS_PER_SEC);
+	sim_run_events();
+	return 0;
+}
+
+__attribute__((constructor))
+static void replay_init(void) {
+	const char *name = getenv("TCS_SCRIPT");
+	FILE *fp = stdin;
+
+	if (name != NULL && (fp = fopen(name, "r")) == NULL) {
+		perror(name);
+		exit(EXIT_FAILURE);
+	}
+	load(fp, name ? name : "stdin");
+	if (fp != stdin) fclose(fp);
+
+	wallStart = wall_ns();
+	atexit(&done);
+	sim_set_wfi(&replay_wfi);
+}
@@ -0,0 +1,120 @@
+/*
+ * sim.h -- host simulator for the TCS firmware
+ *
+ * sim/include stands in for the Xilinx BSP headers and hal.c implements
+ * the driver entry points against simulated registers, so the unmodified
+ * sources in tcs/final build and run as a Linux process. Interrupts go
+ * through a virtual GIC that calls whatever was registered by gic_connect,
+ * and honours the cpu irq mask (Xil_ExceptionDisable, mtcpsr) the way the
+ * Cortex-A9 does: a masked interrupt stays pending until it is unmasked.
+ *
+ * Build the interactive simulator:
+ *    cd final && gcc -O2 -I. -I../sim/include -o ../tcs_sim *.c ../sim/hal.c ../sim/events.c ../sim/console.c
+ *
+ * Linking console.c makes wfi() wait in real time and read commands from
+ * stdin; linking script.c instead replays an event script in virtual time
+ * (c.f. script.c). Either way, events.c holds the commands and the queue of
+ * pending events. recplay.c, without events.c, replays a recording made
+ * with REC_ENABLE (c.f. final/rec.h) and checks the outputs against it.
+ * fsmcheck.c, also without events.c, forks its way through every state the
+ * FSM can reach & checks its invariants (c.f. fsmcheck.c). corridor.c
+ * needs none of this: it runs final/fsm.c alone, thousands of fsm_t's on
+ * simulated peripherals of its own (c.f. corridor.c).
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+
+/*
+ * simulated time in ns since start
+ */
+u64 sim_now(void);
+
+/*
+ * advance simulated time by ns, raising every TTC interval or match that
+ * comes up
+ */
+void sim_advance(u64 ns);
+
+/*
+ * ns until the next TTC interrupt, 0 if the TTC won't raise one
+ */
+u64 sim_ttc_next(void);
+
+/*
+ * set the input levels of an AXI GPIO device (1 buttons, 2 switches); a
+ * change raises its interrupt like the real IP does
+ */
+void sim_gpio_input(u16 deviceId, u32 value);
+
+/*
+ * output levels of an AXI GPIO device (0 leds 0-3, 3 led6)
+ */
+u32 sim_gpio_output(u16 deviceId);
+
+/*
+ * level of a PS GPIO pin (MIO7 is led4)
+ */
+u32 sim_gpiops_pin(u32 pin);
+
+/*
+ * set the raw conversion result of an XADC channel, each conversion off
+ * by up to noise either way
+ */
+void sim_adc_set(u8 channel, u16 raw, u16 noise);
+
+/*
+ * queue a raw conversion for the next read of an XADC channel; each read
+ * takes one, the last one taken holds once the queue runs dry
+ */
+void sim_adc_push(u8 channel, u16 raw);
+
+/*
+ * servo pwm duty cycle in percent, from the AXI timer load values
+ */
+double sim_servo_duty(void);
+
+/*
+ * bytes arriving on uart 0 (wifi) or 1 (tty), raising the FIFO threshold
+ * interrupt as it fills and the receive timeout after the last byte
+ */
+void sim_uart_rx(u16 deviceId, const u8 *buf, u32 len);
+
+/*
+ * called for every byte uart 0 or 1 puts on the line; by default the tty
+ * goes to stdout and the wifi goes nowhere
+ */
+void sim_uart_tx_hook(u16 deviceId, void (*hook)(u8 byte));
+
+/*
+ * raise an interrupt id at the virtual GIC, delivered once unmasked
+ */
+void sim_irq(u32 id);
+
+/*
+ * run one command line (c.f. events.c) against the board now
+ */
+void sim_command(const char *line);
+
+/*
+ * run a command line once simulated time reaches at (ns)
+ */
+void sim_schedule(u64 at, const char *line);
+
+/*
+ * time of the earliest scheduled command, SIM_NEVER if there is none
+ */
+#define SIM_NEVER UINT64_MAX
+u64 sim_next_event(void);
+
+/*
+ * run every scheduled command that is due
+ */
+void sim_run_events(void);
+
+/*
+ * what wfi() does on the host; the hook must advance time or inject an
+ * event, otherwise the firmware's main loop spins
+ */
+void sim_set_wfi(void (*hook)(void));
@@ -0,0 +1,162 @@
+/*
+ * wheelbench.c -- time the timer wheel (c.f. final/wheel.h) against a
+ * sorted list, the obvious alternative, at 10, 100 and 10k timers
+ *
+ * Each run arms n timers up to 2^16 ticks out, then times
+ *    arm    -- adding all n to an empty structure
+ *    rearm  -- cancelling a random timer and adding it again, the FSM's
+ *              restart_ttc pattern
+ *    expire -- running time forward, re-adding every timer as it expires
+ * and prints the mean ns per operation.
+ * Build & run from final/:
+ *    gcc -O2 -I. -I../sim/include -o wheelbench ../sim/wheelbench.c wheel.c && ./wheelbench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "wheel.h"
+
+#define SPREAD 		0xFFFFU		/* ticks out a timer is armed, at most */
+#define REARMS 		200000		/* rearm operations per run */
+#define EXPIRES 	200000		/* expiries per run */
+
+/****************************** SORTED LIST *****************************/
+
+typedef struct list_timer {
+	struct list_timer *next, *prev;
+	u64 expires;
+	int armed;
+} list_timer_t;
+
+static list_timer_t listHead = { &listHead, &listHead, 0, 0 };	/* sentinel */
+
+// walk from the back, new timers tend to be the latest
+static void list_add(list_timer_t *t, u64 expires) {
+	list_timer_t *p = listHead.prev;
+
+	while (p != &listHead && p->expires > expires) p = p->prev;
+	t->expires = expires;
+	t->prev = p;
+	t->next = p->next;
+	p->next->prev = t;
+	p->next = t;
+	t->armed = 1;
+}
+
+static void list_del(list_timer_t *t) {
+	if (!t->armed) return;
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	t->armed = 0;
+}
+
+/****************************** WORKLOAD *****************************/
+
+static u64 rng = 88172645463325252ULL;
+
+static u32 rnd(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return (u32)rng;
+}
+
+static double wall_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static wheel_t wheel;
+static wheel_timer_t *wheelTimers;
+static list_timer_t *listTimers;
+static u64 now;
+static long expired;
+
+static void wheel_expired(wheel_timer_t *t) {
+	expired++;
+	wheel_add(&wheel, t, now + 1 + rnd() % SPREAD);
+}
+
+static void run(int n) {
+	double t0, arm[2], rearm[2], expire[2];
+	int i;
+
+	wheelTimers = calloc((size_t)n, sizeof(*wheelTimers));
+	listTimers = calloc((size_t)n, sizeof(*listTimers));
+	if (wheelTimers == NULL || listTimers == NULL) {
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+
+	/* wheel */
+	rng = 88172645463325252ULL;
+	now = 0;
+	wheel_init(&wheel, now);
+	t0 = wall_ns();
+	for (i = 0; i < n; i++) wheel_add(&wheel, &wheelTimers[i], now + 1 + rnd() % SPREAD);
+	arm[0] = (wall_ns() - t0) / n;
+
+	t0 = wall_ns();
+	for (i = 0; i < REARMS; i++) {
+		wheel_timer_t *t = &wheelTimers[rnd() % (u32)n];
+		wheel_del(&wheel, t);
+		wheel_add(&wheel, t, now + 1 + rnd() % SPREAD);
+	}
+	rearm[0] = (wall_ns() - t0) / REARMS;
+
+	t0 = wall_ns();
+	for (expired = 0; expired < EXPIRES; ) {
+		now = wheel_next(&wheel);	/* a cascade or an expiry, either is one step */
+		wheel_advance(&wheel, now, &wheel_expired);
+	}
+	expire[0] = (wall_ns() - t0) / expired;
+
+	/* sorted list, same sequence of expiries */
+	rng = 88172645463325252ULL;
+	now = 0;
+	t0 = wall_ns();
+	for (i = 0; i < n; i++) list_add(&listTimers[i], now + 1 + rnd() % SPREAD);
+	arm[1] = (wall_ns() - t0) / n;
+
+	t0 = wall_ns();
+	for (i = 0; i < REARMS; i++) {
+		list_timer_t *t = &listTimers[rnd() % (u32)n];
+		list_del(t);
+		list_add(t, now + 1 + rnd() % SPREAD);
+	}
+	rearm[1] = (wall_ns() - t0) / REARMS;
+
+	t0 = wall_ns();
+	for (expired = 0; expired < EXPIRES; ) {
+		list_timer_t *t = listHead.next;
+		now = t->expires;
+		while (t != &listHead && t->expires <= now) {
+			list_del(t);
+			expired++;
+			list_add(t, now + 1 + rnd() % SPREAD);
+			t = listHead.next;
+		}
+	}
+	expire[1] = (wall_ns() - t0) / expired;
+
+	printf("%6d  %8.1f %8.1f  %8.1f %8.1f  %8.1f %8.1f\n", n,
+		arm[0], arm[1], rearm[0], rearm[1], expire[0], expire[1]);
+
+	while (listHead.next != &listHead) list_del(listHead.next);
+	free(wheelTimers);
+	free(listTimers);
+}
+
+int main(void) {
+	printf("ns per operation, wheel vs sorted list\n");
+	printf("timers       arm           rearm         expire\n");
+	printf("          wheel     list   wheel     list   wheel     list\n");
+	run(10);
+	run(100);
+	run(10000);
+	return EXIT_SUCCESS;
+}
@@ -3,16 +3,30 @@
  * 
  * Usage: 
  *    ./substation <-s>  --- run the server
+ *    ./substation -s -e --- run the server in batched epoll mode
+ *    ./substation -s -q --- run the server without printing messages
+ *    ./substation -s -t N --- run the server on N threads, one SO_REUSEPORT socket each
+ *    ./substation -s -n N --- run the server with a roster of N ids (default 30)
  *    ./substation -- run the client and generate NMSGS messages
+ *
+ * Build:
+ *    gcc -o substation substation.c -lpthread
  */
 
+#define _GNU_SOURCE		/* recvmmsg & sendmmsg */
 #include <stdio.h>		/* printf */
 #include <stdlib.h> 		/* EXIT_FAILURE & EXIT_SUCCESS */
 #include <string.h>		/* memset */
+#include <stddef.h>		/* offsetof */
 #include <arpa/inet.h>		/* htons & inet_addr */
 #include <sys/types.h>		/* socket calls */
 #include <sys/socket.h>		/* socket calls */
 #include <unistd.h>		/* close */
+#include <errno.h>		/* EAGAIN & EINTR */
+#include <fcntl.h>		/* O_NONBLOCK */
+#include <sys/epoll.h>		/* epoll calls */
+#include <pthread.h>		/* worker threads */
+#include <stdatomic.h>		/* lock free class values */
 
 /* 
  * Experimental Server Network Properties
@@ -36,7 +50,27 @@
 /* message types */
 #define PING 1
 #define UPDATE 2
-#define CLASS_SIZE_MAX 30
+#define FETCH 3			/* one id's value and version, no roster */
+#define SUBSCRIBE 4		/* fetch, then push a NOTIFY whenever the id changes */
+#define NOTIFY 5		/* unsolicited, server to subscriber */
+#define SUBSCRIBERS_MAX 8	/* per id, the oldest is replaced once full */
+
+/*
+ * framing, for clients behind a byte stream (the board's wifi uart): a
+ * request whose type has FRAMED set is answered, and later pushed to, with
+ *    sync (2) | payload length (2) | payload | crc16 of length & payload (2)
+ * all little endian, so the client can resynchronize after a lost byte
+ */
+#define FRAMED 0x100
+#define FRAME_SYNC 0xA55A
+#define FRAME_HDR 4		/* sync & length */
+#define FRAME_OVERHEAD 6	/* header & crc */
+#define CLASS_SIZE_MAX 30	/* default roster, clients always assume it */
+#define CLASS_SIZE_LIMIT 16000	/* largest -n whose reply fits in one datagram */
+
+#define BATCH_MAX 64		/* datagrams drained per recvmmsg in epoll mode */
+#define THREADS_MAX 64		/* upper bound for -t */
+#define CACHE_LINE 64		/* keeps each hot class slot on its own line */
 
 typedef struct {
   int type;
@@ -56,16 +90,92 @@ typedef struct {
   int values[CLASS_SIZE_MAX];
 } Update_resp_t;
 
+typedef struct {
+  int type;
+  int id;
+} Fetch_req_t;
+
+typedef struct {		/* the id is implied by the request */
+  int type;
+  int value;
+  int version;
+} Fetch_resp_t;
+
+typedef struct {		/* unsolicited, so it names its id */
+  int type;
+  int id;
+  int value;
+  int version;
+} Notify_t;
+
 typedef union {
   Ping_t pingmsg;
   Update_req_t reqmsg;
   Update_resp_t respmsg;
+  Fetch_req_t fetchmsg;
+  Fetch_resp_t fetchrespmsg;
+  Notify_t notifymsg;
 } Msg_t;
 
+/*
+ * one server thread's copy of the class values, as an update response
+ * carries them, & their sum; only its own thread touches it. Taken at
+ * the first UPDATE of a batch, then the batch's own UPDATEs are patched
+ * in, so each reply is a single copy of it
+ */
+typedef struct {
+  int *values;
+  long long sum;
+  int shard;			/* this thread's share of the running sum */
+  int stale;			/* retake at the next UPDATE */
+} Snap_t;
+
+/* per thread buffers for epoll mode */
+typedef struct {
+  Snap_t snap;
+  Msg_t rxbuffs[BATCH_MAX];
+  uint8_t *txbuffs;		/* BATCH_MAX replies of msgsize bytes */
+  struct sockaddr_in rxaddrs[BATCH_MAX];
+  struct iovec rxiovs[BATCH_MAX];
+  struct iovec txiovs[BATCH_MAX];
+  struct mmsghdr rxmsgs[BATCH_MAX];
+  struct mmsghdr txmsgs[BATCH_MAX];
+} Batch_t;
+
+/* one id's value & version, padded so writers on different cores never share a line */
+typedef struct {
+  _Alignas(CACHE_LINE) atomic_int value;
+  atomic_int version;		/* bumped on every UPDATE of the id */
+} Slot_t;
+
+/* one thread's share of the running sum, on a line of its own */
+typedef struct {
+  _Alignas(CACHE_LINE) atomic_llong sum;
+} Sum_t;
+
+/* the subscribers of one id */
+typedef struct {
+  pthread_mutex_t lock;
+  atomic_int n;			/* read without the lock on every UPDATE */
+  int next;			/* entry to replace once full */
+  struct sockaddr_in addrs[SUBSCRIBERS_MAX];
+  int framed[SUBSCRIBERS_MAX];	/* subscribed with a FRAMED request */
+} Subs_t;
+
 /* some helper functions */
 void print_msg(char *direction, Msg_t *msg,int msglen);
-int build_reply(Msg_t *msg,Msg_t *reply, int *replylenp);
+int build_reply(Msg_t *msg,Msg_t *reply, int *replylenp, struct sockaddr_in *from, Snap_t *sp);
+void snap_alloc(Snap_t *sp);
+void snap_take(Snap_t *sp);
+void subscribe(int id, struct sockaddr_in *from, int framed);
+void notify(int sock, int id);
+int frame(uint8_t *buf, int len);
+uint16_t crc16(uint16_t crc, uint8_t *buf, int len);
 void get_input(int id,Msg_t *msg,int *len);
+void serve_batched(int sock, Batch_t *bp);
+int reuseport_socket(void);
+void *worker(void *arg);
+Batch_t *batch_alloc(void);
 
 /* some useful macros */
 #define type(msgp) (*((int*)msgp)) /* type is always first thing in every message */
@@ -73,22 +183,64 @@ void get_input(int id,Msg_t *msg,int *len);
 #define value(msgp) (((Update_req_t*)msgp)->value) /* only in req */
 #define average(msgp)  (((Update_resp_t*)(msgp))->average) /* only in resp */
 #define values(msgp,i) (((Update_resp_t*)(msgp))->values[i]) /* only in resp */
+#define fetchvalue(msgp) (((Fetch_resp_t*)(msgp))->value) /* only in fetch resp */
+#define version(msgp) (((Fetch_resp_t*)(msgp))->version) /* only in fetch resp */
+#define valuesp(msgp) ((int*)(((uint8_t*)msgp)+offsetof(Update_resp_t,values))) /* any roster size */
 
 /* message buffers */
 static Msg_t msgbuff;
-static Msg_t replybuff;
+static Msg_t *replybuff;
+static Snap_t snapbuff;
+
+/*
+ * the current class values, written by every worker without a lock, one
+ * padded slot per id; FETCH, SUBSCRIBE & NOTIFY read them here
+ */
+static Slot_t *classslots;
+static Subs_t *subscribers;	/* one entry per id */
+
+/*
+ * the running sum of the class values, sharded by thread: an UPDATE adds
+ * its delta to its own thread's share, so writers never share a line and
+ * the sum is the total of the shares
+ */
+static Sum_t classsums[THREADS_MAX];
+static atomic_int nshards;
 
-/* the current class values */
-static int classvalues[CLASS_SIZE_MAX];
+/* roster size and the buffer sizes that follow from it */
+static int classsize = CLASS_SIZE_MAX;
+static int respsize = sizeof(Update_resp_t);
+static int msgsize = sizeof(Msg_t);
+
+/* server options */
+static int verbose = TRUE;	/* print every message sent and received */
 
 int main(int argc, char **argv) {
   int server, sock, sent,recd, i;
   struct sockaddr_in echoaddr;
   unsigned int msglen,replylen, addrlen, response;
-  int clientid;
+  int clientid, batched=FALSE, nthreads=1;
+  pthread_t tid;
 	
-  if(argc>=2 && (strcmp(argv[1],"-s")==0)) /* this is the server */
+  if(argc>=2 && (strcmp(argv[1],"-s")==0)) { /* this is the server */
     server=TRUE;
+    for(i=2;i<argc;i++) {
+      if(strcmp(argv[i],"-e")==0)
+        batched=TRUE;
+      else if(strcmp(argv[i],"-q")==0)
+        verbose=FALSE;
+      else if(strcmp(argv[i],"-t")==0 && i+1<argc && atoi(argv[i+1])>=1
+              && atoi(argv[i+1])<=THREADS_MAX) {
+        nthreads=atoi(argv[++i]);
+        batched=TRUE;		/* workers always run the epoll loop */
+      }
+      else if(strcmp(argv[i],"-n")==0 && i+1<argc && atoi(argv[i+1])>=1
+              && atoi(argv[i+1])<=CLASS_SIZE_LIMIT)
+        classsize=atoi(argv[++i]);
+      else
+        errorExit("Usage: substation -s [-e] [-q] [-t 1..64] [-n 1..16000]\n");
+    }
+  }
   else if(argc==2 && (atoi(argv[1])>=0) && (atoi(argv[1])<CLASS_SIZE_MAX)) { /* legit client */
     clientid = atoi(argv[1]);
     server=FALSE;
@@ -96,9 +248,25 @@ int main(int argc, char **argv) {
   else				/* invalid command line */
     errorExit("Usage: substation [-s] <id> -- 0<=id<30\n");
 	
-  /* clear the class values */
-  for(i=0;i<CLASS_SIZE_MAX;i++) 	
-    classvalues[i]=0;
+  /* size the reply for the roster and clear the class values */
+  respsize = offsetof(Update_resp_t,values)+classsize*sizeof(int);
+  if(respsize>msgsize)
+    msgsize=respsize;
+  msgsize+=FRAME_OVERHEAD;	/* room to frame any reply in place */
+  if((replybuff=malloc(msgsize))==NULL
+     || (classslots=aligned_alloc(CACHE_LINE,classsize*sizeof(Slot_t)))==NULL
+     || (subscribers=malloc(classsize*sizeof(Subs_t)))==NULL)
+    errorExit("malloc failure\n");
+  for(i=0;i<classsize;i++) { 	
+    atomic_init(&classslots[i].value,0);
+    atomic_init(&classslots[i].version,0);
+    pthread_mutex_init(&subscribers[i].lock,NULL);
+    atomic_init(&subscribers[i].n,0);
+    subscribers[i].next=0;
+  }
+  for(i=0;i<THREADS_MAX;i++)
+    atomic_init(&classsums[i].sum,0);
+  atomic_init(&nshards,0);
   /* Create a UDP socket */
   if ((sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0)
     errorExit("Failed to create socket\n");
@@ -111,21 +279,36 @@ int main(int argc, char **argv) {
   if(server) {		      
     printf("[Engs62 UDP Server]\n");
     echoaddr.sin_addr.s_addr = htonl(INADDR_ANY);   /* serve any IP address */
+    i=1;
+    if (nthreads>1 && setsockopt(sock,SOL_SOCKET,SO_REUSEPORT,&i,sizeof(i))<0)
+      errorExit("[SERVER] setsockopt failure\n");
     if (bind(sock,(struct sockaddr *)&echoaddr,sizeof(echoaddr))<0) 
       errorExit("[SERVER] bind failure\n");
+    for(i=1;i<nthreads;i++) {	/* main thread is worker 0 */
+      if(pthread_create(&tid,NULL,worker,NULL)!=0)
+        errorExit("[SERVER] pthread_create failure\n");
+      pthread_detach(tid);
+    }
+    if(batched)
+      serve_batched(sock,batch_alloc());
+    snap_alloc(&snapbuff);
     while(1) { 			/* while not killed */
       memset(&msgbuff, 0, sizeof(Msg_t)); /* clear the buffers */
-      memset(&replybuff, 0, sizeof(Msg_t)); 
+      memset(replybuff, 0, msgsize); 
+      snapbuff.stale=TRUE;	/* a batch of one */
       if ((recd=recvfrom(sock,(void*)&msgbuff,sizeof(Msg_t),0,
 												 (struct sockaddr *)&echoaddr,&addrlen))<0)
 				errorExit("[SERVER] recvfrom failure\n");
-      print_msg("recv",&msgbuff,recd);
-      build_reply(&msgbuff,&replybuff,&replylen);
+      if(verbose)
+        print_msg("recv",&msgbuff,recd);
+      if(build_reply(&msgbuff,replybuff,&replylen,&echoaddr,&snapbuff))
+        notify(sock,id(&msgbuff));
       if(replylen>0) {		/* dont reply if message is bad */
-				if ((sent=sendto(sock,(void*)&replybuff,replylen,0,
+				if ((sent=sendto(sock,(void*)replybuff,replylen,0,
 												 (struct sockaddr *)&echoaddr,sizeof(echoaddr))) != replylen)
 					errorExit("[SERVER] sendto failure\n");
-				print_msg("send",&replybuff,replylen);
+				if(verbose)
+				  print_msg("send",replybuff,replylen);
       }
     }
   }  
@@ -133,7 +316,7 @@ int main(int argc, char **argv) {
     echoaddr.sin_addr.s_addr = inet_addr(SERV_ADDR); /* communicate with server IP */
     while(1) {					     /* while not terminated */
       memset(&msgbuff, 0, sizeof(Msg_t));                 /* clear the buffers */
-      memset(&replybuff, 0, sizeof(Msg_t));                
+      memset(replybuff, 0, msgsize);                
       get_input(clientid,&msgbuff,&msglen);
       /* send a message */
       if ((sent=sendto(sock,(void*)&msgbuff,msglen,0, 
@@ -141,10 +324,10 @@ int main(int argc, char **argv) {
 				errorExit("[CLIENT] sendto failure\n");
       print_msg("send",&msgbuff,sent);
       /* print the response */
-      if ((recd=recvfrom(sock,(void*)&replybuff,sizeof(Msg_t),0,
+      if ((recd=recvfrom(sock,(void*)replybuff,msgsize,0,
 												 (struct sockaddr *)&echoaddr,&addrlen))==0)
 				errorExit("[CLIENT] recvfrom failure\n");
-      print_msg("recv",&replybuff,recd);
+      print_msg("recv",replybuff,recd);
     }
   }
   close(sock);
@@ -153,10 +336,17 @@ int main(int argc, char **argv) {
 
 /* server utilities */
 
-int build_reply(Msg_t *msg,Msg_t *reply, int *replylenp) {
-  int i;
-  double sum;
-  if(id(msg)>=0 && id(msg)<CLASS_SIZE_MAX) {
+/*
+ * build_reply -- answer msg from the client at from, with sp the
+ * calling thread's snapshot
+ *
+ * returns TRUE when msg changed a value that has subscribers to notify
+ */
+int build_reply(Msg_t *msg,Msg_t *reply, int *replylenp, struct sockaddr_in *from, Snap_t *sp) {
+  int old, changed=FALSE, framed;
+  framed=type(msg)&FRAMED;
+  type(msg)&=~FRAMED;
+  if(id(msg)>=0 && id(msg)<classsize) {
     type(reply) = type(msg);
     id(reply) = id(msg);
     switch(type(msg)) {
@@ -164,24 +354,283 @@ int build_reply(Msg_t *msg,Msg_t *reply, int *replylenp) {
       *replylenp=sizeof(Ping_t);
 			break;
     case UPDATE:		       /* respoond with an update */
-      classvalues[id(msg)]=value(msg); /* update the value associate with id */
-      for(sum=0,i=0;i<CLASS_SIZE_MAX; i++) { /* calculate the averate */
-				sum+=classvalues[i];	
-				values(reply,i)=classvalues[i]; /* put values in reply */
+      /* update the value associate with id in its own slot, the delta in our share of the sum */
+      old=atomic_exchange_explicit(&classslots[id(msg)].value,value(msg),memory_order_relaxed);
+      atomic_fetch_add_explicit(&classslots[id(msg)].version,1,memory_order_release);
+      atomic_store_explicit(&classsums[sp->shard].sum,	/* only we write our share */
+			    atomic_load_explicit(&classsums[sp->shard].sum,memory_order_relaxed)+value(msg)-old,
+			    memory_order_relaxed);
+      changed=(old!=value(msg) && atomic_load_explicit(&subscribers[id(msg)].n,memory_order_relaxed)>0);
+      if(sp->stale)
+        snap_take(sp);
+      else {			/* already taken this batch, just add our write */
+        sp->sum+=value(msg)-old;
+        sp->values[id(msg)]=value(msg);
       }
-      average(reply)=(int)(sum/(double)CLASS_SIZE_MAX); /* put average in reply */
-      *replylenp=sizeof(Update_resp_t);
+      memcpy(valuesp(reply),sp->values,classsize*sizeof(int));
+      average(reply)=(int)(sp->sum/classsize);
+      *replylenp=respsize;
+      break;
+    case SUBSCRIBE:		/* register, then respond as a fetch */
+      subscribe(id(msg),from,framed);
+      /* fall through */
+    case FETCH:			/* respond with just the value at id */
+      version(reply)=atomic_load_explicit(&classslots[id(msg)].version,memory_order_acquire);
+      fetchvalue(reply)=atomic_load_explicit(&classslots[id(msg)].value,memory_order_relaxed);
+      *replylenp=sizeof(Fetch_resp_t);
       break;
     default:
       *replylenp=0;		/* dont bother to reply */
-      printf("Illegal Message type: ID=%d, type=%d\n",id(msg),type(msg));
+      if(verbose)
+        printf("Illegal Message type: ID=%d, type=%d\n",id(msg),type(msg));
       break;
     }
   }
   else {
     *replylenp=0;
-    printf("Illegal ID=%d\n",id(msg));
+    if(verbose)
+      printf("Illegal ID=%d\n",id(msg));
   }
+  if(framed && *replylenp>0)
+    *replylenp=frame((uint8_t*)reply,*replylenp);
+  return changed;
+}
+
+/*
+ * snap_alloc -- a snapshot for one more server thread, with its own share
+ * of the running sum
+ */
+void snap_alloc(Snap_t *sp) {
+  if((sp->values=malloc(classsize*sizeof(int)))==NULL)
+    errorExit("[SERVER] malloc failure\n");
+  sp->shard=atomic_fetch_add_explicit(&nshards,1,memory_order_relaxed);
+  sp->stale=TRUE;
+}
+
+/*
+ * snap_take -- copy the class values & the running sum to sp, no lock; the
+ * copy is not one instant across threads, an UPDATE another thread is
+ * still applying may be in the values but not yet the sum or the other way
+ * round, so the average can be off from the values by the writes in flight
+ */
+void snap_take(Snap_t *sp) {
+  int i, n;
+
+  for(i=0;i<classsize;i++)
+    sp->values[i]=atomic_load_explicit(&classslots[i].value,memory_order_relaxed);
+  n=atomic_load_explicit(&nshards,memory_order_relaxed);
+  for(sp->sum=0,i=0;i<n;i++)
+    sp->sum+=atomic_load_explicit(&classsums[i].sum,memory_order_relaxed);
+  sp->stale=FALSE;
+}
+
+/*
+ * subscribe -- add from to the subscribers of id, once
+ */
+void subscribe(int id, struct sockaddr_in *from, int framed) {
+  Subs_t *sp = &subscribers[id];
+  int i, n;
+
+  pthread_mutex_lock(&sp->lock);
+  n=atomic_load_explicit(&sp->n,memory_order_relaxed);
+  for(i=0;i<n;i++)		/* a resubscribe just refreshes */
+    if(sp->addrs[i].sin_addr.s_addr==from->sin_addr.s_addr && sp->addrs[i].sin_port==from->sin_port)
+      break;
+  if(i==n) {
+    if(n<SUBSCRIBERS_MAX)
+      atomic_store_explicit(&sp->n,n+1,memory_order_relaxed);
+    else {
+      i=sp->next;
+      sp->next=(sp->next+1)%SUBSCRIBERS_MAX;
+    }
+    sp->addrs[i]=*from;
+  }
+  sp->framed[i]=framed;
+  pthread_mutex_unlock(&sp->lock);
+}
+
+/*
+ * notify -- push the current value of id to all of its subscribers
+ */
+void notify(int sock, int id) {
+  Subs_t *sp = &subscribers[id];
+  struct sockaddr_in addrs[SUBSCRIBERS_MAX];
+  int framed[SUBSCRIBERS_MAX];
+  uint8_t notes[2][sizeof(Notify_t)+FRAME_OVERHEAD]; /* plain & framed */
+  int i, n, lens[2];
+
+  pthread_mutex_lock(&sp->lock);
+  n=atomic_load_explicit(&sp->n,memory_order_relaxed);
+  memcpy(addrs,sp->addrs,n*sizeof(struct sockaddr_in));
+  memcpy(framed,sp->framed,n*sizeof(int));
+  pthread_mutex_unlock(&sp->lock);
+
+  type(notes[0])=NOTIFY;
+  id(notes[0])=id;
+  ((Notify_t*)notes[0])->version=atomic_load_explicit(&classslots[id].version,memory_order_acquire);
+  ((Notify_t*)notes[0])->value=atomic_load_explicit(&classslots[id].value,memory_order_relaxed);
+  lens[0]=sizeof(Notify_t);
+  memcpy(notes[1],notes[0],sizeof(Notify_t));
+  lens[1]=frame(notes[1],sizeof(Notify_t));
+  for(i=0;i<n;i++) {		/* udp, a lost push is repaired by the next resubscribe */
+    sendto(sock,(void*)notes[framed[i]!=0],lens[framed[i]!=0],0,
+	   (struct sockaddr *)&addrs[i],sizeof(struct sockaddr_in));
+    if(verbose)
+      print_msg("push",(Msg_t*)notes[framed[i]!=0],lens[framed[i]!=0]);
+  }
+}
+
+/*
+ * frame -- wrap the len byte message in buf in place, buf must have
+ * FRAME_OVERHEAD spare bytes; returns the framed length
+ */
+int frame(uint8_t *buf, int len) {
+  uint16_t crc;
+
+  memmove(buf+FRAME_HDR,buf,len);
+  buf[0]=FRAME_SYNC&0xFF;
+  buf[1]=FRAME_SYNC>>8;
+  buf[2]=len&0xFF;
+  buf[3]=len>>8;
+  crc=crc16(0xFFFF,buf+2,len+2);
+  buf[FRAME_HDR+len]=crc&0xFF;
+  buf[FRAME_HDR+len+1]=crc>>8;
+  return len+FRAME_OVERHEAD;
+}
+
+/*
+ * crc16 -- CRC-16/CCITT (poly 0x1021), continued from crc over buf
+ */
+uint16_t crc16(uint16_t crc, uint8_t *buf, int len) {
+  int i;
+
+  while(len--) {
+    crc^=(uint16_t)(*buf++)<<8;
+    for(i=0;i<8;i++)
+      crc=(crc&0x8000) ? (crc<<1)^0x1021 : crc<<1;
+  }
+  return crc;
+}
+
+/*
+ * serve_batched -- epoll server loop, drains up to BATCH_MAX datagrams
+ * per recvmmsg and answers them all with a single sendmmsg
+ */
+void serve_batched(int sock, Batch_t *bp) {
+  int epfd, i, n, recd, nreply, sent, replylen;
+  struct epoll_event ev;
+
+  if(fcntl(sock,F_SETFL,fcntl(sock,F_GETFL,0)|O_NONBLOCK)<0)
+    errorExit("[SERVER] fcntl failure\n");
+  if((epfd=epoll_create1(0))<0)
+    errorExit("[SERVER] epoll_create failure\n");
+  ev.events=EPOLLIN;
+  ev.data.fd=sock;
+  if(epoll_ctl(epfd,EPOLL_CTL_ADD,sock,&ev)<0)
+    errorExit("[SERVER] epoll_ctl failure\n");
+
+  for(i=0;i<BATCH_MAX;i++) {	/* wire up the batch buffers once */
+    bp->rxiovs[i].iov_base=&bp->rxbuffs[i];
+    bp->rxiovs[i].iov_len=sizeof(Msg_t);
+    bp->txiovs[i].iov_base=bp->txbuffs+i*msgsize;
+  }
+
+  while(1) {			/* while not killed */
+    if(epoll_wait(epfd,&ev,1,-1)<0) {
+      if(errno==EINTR)
+        continue;
+      errorExit("[SERVER] epoll_wait failure\n");
+    }
+    while(1) {			/* drain the socket */
+      for(i=0;i<BATCH_MAX;i++) {
+        memset(&bp->rxmsgs[i],0,sizeof(struct mmsghdr));
+        bp->rxmsgs[i].msg_hdr.msg_name=&bp->rxaddrs[i];
+        bp->rxmsgs[i].msg_hdr.msg_namelen=sizeof(struct sockaddr_in);
+        bp->rxmsgs[i].msg_hdr.msg_iov=&bp->rxiovs[i];
+        bp->rxmsgs[i].msg_hdr.msg_iovlen=1;
+      }
+      if((n=recvmmsg(sock,bp->rxmsgs,BATCH_MAX,MSG_DONTWAIT,NULL))<0) {
+        if(errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR)
+          break;
+        errorExit("[SERVER] recvmmsg failure\n");
+      }
+      bp->snap.stale=TRUE;	/* others' writes since the last batch */
+      for(nreply=0,i=0;i<n;i++) {
+        recd=bp->rxmsgs[i].msg_len;
+        /* short datagrams read as zero, as with the cleared msgbuff */
+        memset((uint8_t*)&bp->rxbuffs[i]+recd,0,sizeof(Msg_t)-recd);
+        if(verbose)
+          print_msg("recv",&bp->rxbuffs[i],recd);
+        if(build_reply(&bp->rxbuffs[i],(Msg_t*)(bp->txbuffs+nreply*msgsize),&replylen,&bp->rxaddrs[i],&bp->snap))
+          notify(sock,id(&bp->rxbuffs[i]));
+        if(replylen>0) {	/* dont reply if message is bad */
+          bp->txiovs[nreply].iov_len=replylen;
+          memset(&bp->txmsgs[nreply],0,sizeof(struct mmsghdr));
+          bp->txmsgs[nreply].msg_hdr.msg_name=&bp->rxaddrs[i];
+          bp->txmsgs[nreply].msg_hdr.msg_namelen=bp->rxmsgs[i].msg_hdr.msg_namelen;
+          bp->txmsgs[nreply].msg_hdr.msg_iov=&bp->txiovs[nreply];
+          bp->txmsgs[nreply].msg_hdr.msg_iovlen=1;
+          if(verbose)
+            print_msg("send",(Msg_t*)(bp->txbuffs+nreply*msgsize),replylen);
+          nreply++;
+        }
+      }
+      for(i=0;i<nreply;i+=sent) {
+        if((sent=sendmmsg(sock,&bp->txmsgs[i],nreply-i,0))<0) {
+          if(errno==EAGAIN || errno==EWOULDBLOCK)
+            break;		/* udp, drop the rest of the batch */
+          if(errno==EINTR) {
+            sent=0;
+            continue;
+          }
+          errorExit("[SERVER] sendmmsg failure\n");
+        }
+      }
+      if(n<BATCH_MAX)		/* socket is empty */
+        break;
+    }
+  }
+}
+
+/*
+ * reuseport_socket -- another udp socket bound to the server port,
+ * the kernel spreads incoming datagrams across the sockets by client
+ */
+int reuseport_socket(void) {
+  int sock, on=1;
+  struct sockaddr_in servaddr;
+
+  if ((sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0)
+    errorExit("Failed to create socket\n");
+  if (setsockopt(sock,SOL_SOCKET,SO_REUSEPORT,&on,sizeof(on))<0)
+    errorExit("[SERVER] setsockopt failure\n");
+  memset(&servaddr, 0, sizeof(servaddr));
+  servaddr.sin_family = AF_INET;
+  servaddr.sin_port = htons(UDP_ECHO_PORT);
+  servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(sock,(struct sockaddr *)&servaddr,sizeof(servaddr))<0)
+    errorExit("[SERVER] bind failure\n");
+  return sock;
+}
+
+/*
+ * worker -- extra server thread with its own socket and batch buffers
+ */
+void *worker(void *arg) {
+  serve_batched(reuseport_socket(),batch_alloc());
+  return NULL;
+}
+
+/*
+ * batch_alloc -- batch buffers for one epoll loop, replies sized for the roster
+ */
+Batch_t *batch_alloc(void) {
+  Batch_t *bp;
+
+  if((bp=malloc(sizeof(Batch_t)))==NULL || (bp->txbuffs=malloc(BATCH_MAX*msgsize))==NULL)
+    errorExit("[SERVER] malloc failure\n");
+  snap_alloc(&bp->snap);
+  return bp;
 }
 
 /* client utilities */
@@ -189,7 +638,7 @@ int build_reply(Msg_t *msg,Msg_t *reply, int *replylenp) {
 void get_input(int id,Msg_t *msg,int *len) {
   int intype,inval;
 	
-  printf("Send PING (1), UPDATE (2) ? : ");
+  printf("Send PING (1), UPDATE (2), FETCH (3) ? : ");
   fflush(stdout);
   scanf("%d",&intype);
   if(intype==1) {
@@ -206,6 +655,11 @@ void get_input(int id,Msg_t *msg,int *len) {
     value(msg)=inval;
     *len=sizeof(Update_req_t);
   }
+  else if(intype==3) {
+    type(msg)=FETCH;
+    id(msg)=id;
+    *len=sizeof(Fetch_req_t);
+  }
   else {
     printf("exit\n");
     exit(EXIT_SUCCESS);
@@ -217,24 +671,45 @@ void get_input(int id,Msg_t *msg,int *len) {
  */
 void print_msg(char *direction, Msg_t *msg, int msglen) {
   int i;
-  switch(type(msg)) {
+  uint8_t *bytes = (uint8_t*)msg;
+  /* a framed reply, print what it carries */
+  if(msglen>=FRAME_OVERHEAD && bytes[0]==(FRAME_SYNC&0xFF) && bytes[1]==(FRAME_SYNC>>8)) {
+    print_msg(direction,(Msg_t*)(bytes+FRAME_HDR),msglen-FRAME_OVERHEAD);
+    return;
+  }
+  switch(type(msg)&~FRAMED) {
   case PING:
     printf("%s: [PING,id=%d]\n",direction,id(msg));
     break;
   case UPDATE:
-    if(msglen!=sizeof(Update_req_t) && msglen!=sizeof(Update_resp_t))
+    if(msglen!=sizeof(Update_req_t) && msglen!=respsize)
       printf("[Invalid UPDATE message,id=%d, length=%d]\n",id(msg),msglen);
     else {
       printf("%s: [UPDATE,id=%d",direction,id(msg));
-      if(msglen==sizeof(Update_resp_t)) {
+      if(msglen==respsize) {
 				printf(",average=%d,{",average(msg));
-				for(i=0;i<CLASS_SIZE_MAX;i++)
-					printf(" %d",values(msg,i));
+				for(i=0;i<classsize;i++)
+					printf(" %d",valuesp(msg)[i]);
 				printf("}]");
       }
       else 
 				printf(",value=%d]",value(msg));
       printf("\n");
     }
+    break;
+  case FETCH:
+  case SUBSCRIBE:
+    if(msglen==sizeof(Fetch_req_t))
+      printf("%s: [%s,id=%d]\n",direction,(type(msg)&~FRAMED)==FETCH ? "FETCH" : "SUBSCRIBE",id(msg));
+    else if(msglen==sizeof(Fetch_resp_t))
+      printf("%s: [%s,value=%d,version=%d]\n",direction,(type(msg)&~FRAMED)==FETCH ? "FETCH" : "SUBSCRIBE",
+	     fetchvalue(msg),version(msg));
+    else
+      printf("[Invalid %s message, length=%d]\n",(type(msg)&~FRAMED)==FETCH ? "FETCH" : "SUBSCRIBE",msglen);
+    break;
+  case NOTIFY:
+    printf("%s: [NOTIFY,id=%d,value=%d,version=%d]\n",direction,id(msg),
+	   msg->notifymsg.value,msg->notifymsg.version);
+    break;
   }
 }
@@ -0,0 +1,120 @@
+/*
+ * Render a TCS trace capture -- encoded trace records mixed in with the
+ * board's text output, as written with TRACE_BINARY 1 (c.f. final/trace.h);
+ * a damaged record is reported and skipped
+ *
+ * Usage:
+ *    ./tracedump [capture]  --- decode capture (default stdin) to stdout
+ *
+ * Capture the tty with e.g.
+ *    stty -F /dev/ttyUSB1 115200 raw && cat /dev/ttyUSB1 > capture.bin
+ *
+ * Build:
+ *    gcc -Isim/include -Ifinal -o tracedump tracedump.c
+ */
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h> 		/* EXIT_FAILURE & EXIT_SUCCESS */
+#include "trace.h"		/* record layout, event ids & formats */
+
+#define TRACE_FMT(id, fmt) fmt,
+static const char *const formats[TR_NUM_EVENTS] = { TRACE_EVENTS(TRACE_FMT) };
+
+static unsigned long long ticks = 0;	/* since boot, past the 32 bit record time's wraps */
+static unsigned int lasttime = 0;
+static int suspect = 0;			/* a record went back in time ... */
+static unsigned int suspecttime;	/* ... to this */
+
+/*
+ * decode the TRACE_REC_CHARS after a TRACE_SYNC, little endian; FALSE if
+ * the event isn't one we know
+ */
+static int decode(const unsigned char *c, trace_rec_t *rec) {
+  unsigned char b[TRACE_REC_BYTES];
+  unsigned int w;
+  int i, j;
+
+  for(i=0; i<TRACE_REC_BYTES/3; i++) {
+    for(w=0, j=0; j<4; j++)
+      w |= (unsigned int)(c[4*i+j]-TRACE_CHAR_BASE) << (6*j);
+    b[3*i] = w & 0xFF;
+    b[3*i+1] = (w>>8) & 0xFF;
+    b[3*i+2] = (w>>16) & 0xFF;
+  }
+
+  rec->time = (unsigned int)b[0] | (unsigned int)b[1]<<8 | (unsigned int)b[2]<<16 | (unsigned int)b[3]<<24;
+  rec->id = (unsigned short)(b[4] | b[5]<<8);
+  for(i=0; i<3; i++)
+    rec->args[i] = (short)(b[6+2*i] | b[7+2*i]<<8);
+  return rec->id < TR_NUM_EVENTS;
+}
+
+/*
+ * records come out in order, so each one's time is a step forward from
+ * the last (across a wrap, modulo 2^32). One that steps back is damaged
+ * and dropped -- unless the next steps forward from it, then it was the
+ * last that was damaged and the clock is put back. FALSE if dropped
+ */
+static int render(trace_rec_t *rec) {
+  unsigned int step = rec->time - lasttime;
+
+  if(step >= 0x80000000u) {
+    if(!suspect || rec->time - suspecttime >= 0x80000000u) {
+      suspect = 1;
+      suspecttime = rec->time;
+      return 0;
+    }
+    ticks -= lasttime - rec->time;
+    fprintf(stderr,"[trace time put back %u ticks]\n",lasttime - rec->time);
+  }
+  else
+    ticks += step;
+  suspect = 0;
+  lasttime = rec->time;
+
+  printf("[%12.6f] ",(double)ticks/TRACE_TICK_HZ);
+  printf(formats[rec->id],rec->args[0],rec->args[1],rec->args[2]);
+  printf("\n");
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  FILE *fp = stdin;
+  unsigned char rec[TRACE_REC_CHARS];
+  trace_rec_t r;
+  int c, n;
+
+  if(argc > 2) {
+    fprintf(stderr,"usage: %s [capture]\n",argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  if(argc == 2 && (fp = fopen(argv[1],"rb")) == NULL) {
+    perror(argv[1]);
+    exit(EXIT_FAILURE);
+  }
+
+  while((c = getc(fp)) != EOF) {
+    if(c != TRACE_SYNC) {	/* ordinary text passes through */
+      putchar(c);
+      continue;
+    }
+    /* a character that can't be in a record ends it early; hunt again from there */
+    for(n=0; n<TRACE_REC_CHARS && (c = getc(fp)) != EOF; n++) {
+      if(c < TRACE_CHAR_BASE || c >= TRACE_CHAR_BASE+64) {
+        ungetc(c,fp);
+        break;
+      }
+      rec[n] = c;
+    }
+    if(c == EOF && n < TRACE_REC_CHARS) {
+      fprintf(stderr,"[truncated record at end of capture]\n");
+      break;
+    }
+    if(n < TRACE_REC_CHARS || !decode(rec,&r) || !render(&r))
+      fprintf(stderr,"[damaged trace record skipped]\n");
+  }
+
+  if(fp != stdin)
+    fclose(fp);
+  exit(EXIT_SUCCESS);
+}